@@ -1,1220 +1,7371 @@
-﻿/*
-    Файл реализации хэш-мультиотображения c_hash_multimap
-    Разработка, отладка и сборка производилась в:
-    ОС: Windows 10/x64
-    IDE: Code::Blocks 17.12
-    Компилятор: default Code::Blocks 17.12 MinGW
-    Разработчик: Глухманюк Максим
-    Эл. почта: mgneo@yandex.ru
-    Место: Российская Федерация, Самарская область, Сызрань
-    Дата: 11.04.2018
-    Лицензия: GPLv3
-*/
-
-#include <stdlib.h>
-#include <stddef.h>
-#include <stdint.h>
-#include <memory.h>
-
-#include "c_hash_multimap.h"
-
-// Количество слотов, задаваемое хэш-мультиотображению с нулем слотов при автоматическом
-// расширении.
-#define C_HASH_MULTIMAP_0 ( (size_t) 1024 )
-
-// Минимально возможное значение max_load_factor.
-#define C_HASH_MULTIMAP_MLF_MIN ( (float) 0.01f )
-
-// Максимально возможное значение max_load_factor.
-#define C_HASH_MULTIMAP_MLF_MAX ( (float) 1.f )
-
-typedef struct s_c_hash_multimap_node c_hash_multimap_node;
-
-typedef struct s_c_hash_multimap_chain c_hash_multimap_chain;
-
-struct s_c_hash_multimap_node
-{
-    c_hash_multimap_node *next_node;
-
-    void *key;
-    void *data;
-};
-
-// Цепочка содержит узлы с одинаковым ключом.
-struct s_c_hash_multimap_chain
-{
-    c_hash_multimap_chain *next_chain;
-    c_hash_multimap_node *head;
-
-    size_t k_hash,
-           nodes_count;
-};
-
-struct s_c_hash_multimap
-{
-    // Функция генерации хэша по ключу.
-    size_t (*hash_key)(const void *const _key);
-
-    // Функция детального сравнения ключей.
-    // В случае идентичности ключей должна возвращать > 0.
-    size_t (*comp_key)(const void *const _key_a,
-                       const void *const _key_b);
-    // Функция детального сравнения данных.
-    // В случае идентичности данных должна возвращать > 0.
-    size_t (*comp_data)(const void *const _data_a,
-                        const void *const _data_b);
-
-    size_t slots_count,
-           chains_count,
-           nodes_count;
-
-    float max_load_factor;
-
-    c_hash_multimap_chain **slots;
-};
-
-// Если расположение задано, в него помещается код.
-static void error_set(size_t *const _error,
-                      const size_t _code)
-{
-    if (_error != NULL)
-    {
-        *_error = _code;
-    }
-}
-
-// Создание хэш-мультиотображения.
-// Позволяет создавать хэш-мультиотображение с нулем слотов.
-// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-c_hash_multimap *c_hash_multimap_create(size_t (*const _hash_key)(const void *const _key),
-                                        size_t (*const _comp_key)(const void *const _key_a,
-                                                                  const void *const _key_b),
-                                        size_t (*const _comp_data)(const void *const _data_a,
-                                                                   const void *const _data_b),
-                                        const size_t _slots_count,
-                                        const float _max_load_factor,
-                                        size_t *const _error)
-{
-    if (_hash_key == NULL)
-    {
-        error_set(_error, 1);
-        return NULL;
-    }
-
-    if (_comp_key == NULL)
-    {
-        error_set(_error, 2);
-        return NULL;
-    }
-    if (_comp_data == NULL)
-    {
-        error_set(_error, 3);
-        return NULL;
-    }
-
-    if ( (_max_load_factor < C_HASH_MULTIMAP_MLF_MIN) ||
-         (_max_load_factor > C_HASH_MULTIMAP_MLF_MAX) )
-    {
-        error_set(_error, 4);
-        return NULL;
-    }
-
-    c_hash_multimap_chain **new_slots = NULL;
-
-    if (_slots_count > 0)
-    {
-        const size_t new_slots_size = _slots_count * sizeof(c_hash_multimap_chain*);
-        if ( (new_slots_size == 0) ||
-             (new_slots_size / _slots_count != sizeof(c_hash_multimap_chain*)) )
-        {
-            error_set(_error, 5);
-            return NULL;
-        }
-
-        new_slots = malloc(new_slots_size);
-        if (new_slots == NULL)
-        {
-            error_set(_error, 6);
-            return NULL;
-        }
-
-        memset(new_slots, 0, new_slots_size);
-    }
-
-    c_hash_multimap *const new_hash_multimap = malloc(sizeof(c_hash_multimap));
-    if (new_hash_multimap == NULL)
-    {
-        free(new_slots);
-        error_set(_error, 7);
-        return NULL;
-    }
-
-    new_hash_multimap->hash_key = _hash_key;
-    new_hash_multimap->comp_key = _comp_key;
-    new_hash_multimap->comp_data = _comp_data;
-
-    new_hash_multimap->slots_count = _slots_count;
-    new_hash_multimap->chains_count = 0;
-    new_hash_multimap->nodes_count = 0;
-
-
-    new_hash_multimap->max_load_factor = _max_load_factor;
-
-    new_hash_multimap->slots = new_slots;
-
-    return new_hash_multimap;
-}
-
-// Удаляет хэш-мультиотображение.
-// В случае успеха возвращает > 0, иначе < 0.
-ptrdiff_t c_hash_multimap_delete(c_hash_multimap *const _hash_multimap,
-                                 void (*const _del_key)(void *const _key),
-                                 void (*const _del_data)(void *const _data))
-{
-    if (c_hash_multimap_clear(_hash_multimap, _del_key, _del_data) < 0)
-    {
-        return -1;
-    }
-
-    free(_hash_multimap->slots);
-
-    free(_hash_multimap);
-
-    return 1;
-}
-
-// Очищает хэш-мультиотображение ото всех элементов, количество слотов сохраняется.
-// В случае успешного очищения возвращает > 0.
-// Если очищать не от чего, возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_clear(c_hash_multimap *const _hash_multimap,
-                                void (*const _del_key)(void *const _key),
-                                void (*const _del_data)(void *const _data))
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-
-    // Если очищать не от чего, то ничего не делаем.
-    if (_hash_multimap->chains_count == 0)
-    {
-        return 0;
-    }
-
-    size_t count = _hash_multimap->chains_count;
-
-    // Макросы дублирования кода для избавления от проверок в циклах.
-
-    // Открытие циклов.
-    #define C_HASH_MULTIMAP_CLEAR_BEGIN\
-    for (size_t s = 0; (s < _hash_multimap->slots_count)&&(count > 0); ++s)\
-    {\
-        if (_hash_multimap->slots[s] != NULL)\
-        {\
-            c_hash_multimap_chain *select_chain = _hash_multimap->slots[s],\
-                                  *delete_chain;\
-            /* Обойдем все цепочки слота */\
-            while (select_chain != NULL)\
-            {\
-                delete_chain = select_chain;\
-                select_chain = select_chain->next_chain;\
-                /* Обойдем все узлы цепочки */\
-                c_hash_multimap_node *select_node = delete_chain->head,\
-                                     *delete_node;\
-                while (select_node != NULL)\
-                {\
-                    delete_node = select_node;\
-                    select_node = select_node->next_node;\
-
-    // Закрытие циклов.
-    #define C_HASH_MULTIMAP_CLEAR_END\
-                    /* Освободим память из-под узла */\
-                    free(delete_node);\
-                }\
-                /* Освободим память из-под цепочки */\
-                free(delete_chain);\
-                --count;\
-            }\
-            _hash_multimap->slots[s] = NULL;\
-        }\
-    }
-
-    if (_del_key != NULL)
-    {
-        if (_del_data != NULL)
-        {
-            // Функция удаления задана и для ключа, и для данных.
-            C_HASH_MULTIMAP_CLEAR_BEGIN
-
-            _del_key(delete_node->key);
-            _del_data(delete_node->data);
-
-            C_HASH_MULTIMAP_CLEAR_END
-        } else {
-            // Функция удаления задана только для ключа.
-            C_HASH_MULTIMAP_CLEAR_BEGIN
-
-            _del_key(delete_node->key);
-
-            C_HASH_MULTIMAP_CLEAR_END
-        }
-    } else {
-        if (_del_data != NULL)
-        {
-            // Функция удаления задана только для данных.
-            C_HASH_MULTIMAP_CLEAR_BEGIN
-
-            _del_data(delete_node->data);
-
-            C_HASH_MULTIMAP_CLEAR_END
-        } else {
-            // Функция удаления не задана ни для ключа, ни для данных.
-            C_HASH_MULTIMAP_CLEAR_BEGIN
-
-            C_HASH_MULTIMAP_CLEAR_END
-        }
-    }
-
-    #undef C_HASH_MULTIMAP_CLEAR_BEGIN
-    #undef C_HASH_MULTIMAP_CLEAR_END
-
-    _hash_multimap->chains_count = 0;
-    _hash_multimap->nodes_count = 0;
-
-    return 1;
-}
-
-// Задает хэш-мультиотображению новое количество слотов.
-// Позволяет расширить хэш-мультиотображение с нулем слотов.
-// Если в хэш-мультиотображении есть хотя бы один узел (пара ключ-данные), то попытка задать нулевое количество слотов
-// считается ошибкой.
-// Если хэш-мультиотображение перестраивается функция возвращает > 0.
-// Если не перестраивается, функция возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_resize(c_hash_multimap *const _hash_multimap,
-                                 const size_t _slots_count)
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-
-    if (_slots_count == _hash_multimap->slots_count)
-    {
-        return 0;
-    }
-
-    // Если задано нулевое число слотов.
-    if (_slots_count == 0)
-    {
-        // А в хэш-мультиотображении имеются узлы.
-        if (_hash_multimap->nodes_count != 0)
-        {
-            return -2;
-        }
-
-        // Иначе все ок.
-        free(_hash_multimap->slots);
-        _hash_multimap->slots = NULL;
-
-        _hash_multimap->slots_count = 0;
-
-        return 1;
-    } else {
-        // Если задано ненулевое число слотов.
-
-        // Определим количество памяти, необходимое под новые слоты.
-        const size_t new_slots_size = _slots_count * sizeof(c_hash_multimap_chain*);
-
-        // Контроль переполнения.
-        if ( (new_slots_size == 0) ||
-             (new_slots_size / _slots_count != sizeof(c_hash_multimap_chain*)) )
-        {
-            return -3;
-        }
-
-        // Попытаемся выделить память под новые слоты.
-        c_hash_multimap_chain **const new_slots = malloc(new_slots_size);
-
-        // Контроль успешности выделения памяти.
-        if (new_slots == NULL)
-        {
-            return -4;
-        }
-
-        memset(new_slots, 0, new_slots_size);
-
-        // Если в хэш-мультиотображении есть данные, их необходимо перенести.
-        if (_hash_multimap->nodes_count > 0)
-        {
-            // Проходим по всем слотам.
-            size_t count = _hash_multimap->chains_count;
-            for (size_t s = 0; (s < _hash_multimap->slots_count)&&(count > 0); ++s)
-            {
-                if (_hash_multimap->slots[s] != NULL)
-                {
-                    // Проходим по всем цепочкам слота.
-                    c_hash_multimap_chain *select_chain = _hash_multimap->slots[s],
-                                          *relocate_chain;
-                    while (select_chain != NULL)
-                    {
-                        relocate_chain = select_chain;
-                        select_chain = select_chain->next_chain;
-
-                        // Вычисляем хэш переносимой цепочки, приведенный к новому количеству слотов.
-                        const size_t presented_k_hash = relocate_chain->k_hash % _slots_count;
-
-                        // Переносим.
-                        relocate_chain->next_chain = new_slots[presented_k_hash];
-                        new_slots[presented_k_hash] = relocate_chain;
-
-                        --count;
-                    }
-                }
-            }
-
-        }
-
-        // Освобождаем память из-под старых слотов.
-        free(_hash_multimap->slots);
-
-        // Используем новые слоты.
-        _hash_multimap->slots = new_slots;
-        _hash_multimap->slots_count = _slots_count;
-
-        return 2;
-    }
-}
-
-// Вставляет в хэш-мультиотображение новый элемент (пара ключ-значение).
-// В случае успешной вставки возвращает > 0, ключ и данные захватываются хэш-мультиотображением.
-// В случае ошибки возвращает < 0, ключ и данные не захватываются хэш-мультиотображением.
-ptrdiff_t c_hash_multimap_insert(c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 const void *const _data)
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-    if (_key == NULL)
-    {
-        return -2;
-    }
-    if (_data == NULL)
-    {
-        return -3;
-    }
-
-    // Первым делом контролируем процесс увеличения количества слотов.
-
-    // Если слотов нет вообще.
-    if (_hash_multimap->slots_count == 0)
-    {
-        // Пытаемся расширить слоты.
-        if (c_hash_multimap_resize(_hash_multimap, C_HASH_MULTIMAP_0) <= 0)
-        {
-            return -4;
-        }
-    } else {
-        // Если слоты есть, то при достижении предела загруженности увеличиваем количество слотов.
-        const float load_factor = (float)_hash_multimap->chains_count / _hash_multimap->slots_count;
-        if (load_factor >= _hash_multimap->max_load_factor)
-        {
-            // Определим новое количество слотов.
-            size_t new_slots_count = (size_t)(_hash_multimap->slots_count * 1.75f);
-            // Контролируем переполнение.
-            if (new_slots_count < _hash_multimap->slots_count)
-            {
-                return -5;
-            }
-            new_slots_count += 1;
-            if (new_slots_count == 0)
-            {
-                return -6;
-            }
-
-            // Пытаемся расширить слоты.
-            if (c_hash_multimap_resize(_hash_multimap, new_slots_count) < 0)
-            {
-                return -7;
-            }
-        }
-    }
-
-    // Вставляем данные в хэш-мультимножество.
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    // Попытаемся найти с нужном слоте цепочку, которая хранит узлы с аналогичным ключом.
-    c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-    while (select_chain != NULL)
-    {
-        if (select_chain->k_hash == k_hash)
-        {
-            if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-            {
-                break;
-            }
-        }
-        select_chain = select_chain->next_chain;
-    }
-
-    // Если цепочки, которая хранит узлы с заданным ключом, нет, то создаем ее.
-    size_t created = 0;
-    if (select_chain == NULL)
-    {
-        created = 1;
-
-        // Пытаемся выделить память под цепочку.
-        c_hash_multimap_chain *const new_chain = malloc(sizeof(c_hash_multimap_chain));
-
-        // Если память выделить не удалось.
-        if (new_chain == NULL)
-        {
-            return -8;
-        }
-
-        // Интегрируем новую цепочку в слот и выделяем ее, это необходимо для дальнейшей единообразной обработки.
-        new_chain->next_chain = _hash_multimap->slots[presented_k_hash];
-        _hash_multimap->slots[presented_k_hash] = new_chain;
-
-        // Заполняем новую цепочку.
-        new_chain->head = NULL;
-        new_chain->nodes_count = 0;
-        new_chain->k_hash = k_hash;
-
-        // Увеличиваем счетчик цепочек в хэш-мультиотображении.
-        ++_hash_multimap->chains_count;
-
-        // Выделяем вставленную цепочку.
-        select_chain = new_chain;
-    }
-
-    // Пытаемся выделить память под новый узел.
-    c_hash_multimap_node *const new_node = malloc(sizeof(c_hash_multimap_node));
-
-    // Если память под узел выделить не удалось.
-    if (new_node == NULL)
-    {
-        // И если цепочка была создана.
-        if (created == 1)
-        {
-            // Ампутация созданной цепочки, потому что цепочка без узлов не должна существовать.
-            _hash_multimap->slots[presented_k_hash] = select_chain->next_chain;
-            // Уменьшаем счетчик цепочек в хэш-мультиотображении.
-            --_hash_multimap->chains_count;
-            // Освобождаем память из-под цепочки.
-            free(select_chain);
-        }
-
-        return -10;
-    }
-
-    // Узел захватывает ключ и данные.
-    new_node->key = (void*)_key;
-    new_node->data = (void*)_data;
-    // Встраиваем узел в выделенную цепочку.
-    new_node->next_node = select_chain->head;
-    select_chain->head = new_node;
-    // Увеличиваем счетчик узлов выделенной цепочки.
-    ++select_chain->nodes_count;
-    // Увеличичваем счетчик узлов в хэш-мультиотоюражении.
-    ++_hash_multimap->nodes_count;
-
-    return 1;
-}
-
-// Удаляет заданную пару из хэш-мультиотображения.
-// В случае успещного удаления возвращает > 0.
-// Если такой пары нет, возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_erase(c_hash_multimap *const _hash_multimap,
-                                const void *const _key,
-                                const void *const _data,
-                                void (*const _del_key)(void *const _key),
-                                void (*const _del_data)(void *const _data))
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-    if (_key == NULL)
-    {
-        return -2;
-    }
-    if (_data == NULL)
-    {
-        return -3;
-    }
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        // Перебираем цепочки слота.
-        c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash],
-                              *prev_chain = NULL;
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    // Перебираем узлы цепочки в поисках такого узла.
-                    c_hash_multimap_node *select_node = select_chain->head,
-                                         *prev_node = NULL;
-                    while (select_node != NULL)
-                    {
-                        if (_hash_multimap->comp_data(select_node->data, _data) > 0)
-                        {
-                            // Нашли требуемый узел.
-
-                            // Ампутируем узел из цепочки.
-                            if (prev_node == NULL)
-                            {
-                                select_chain->head = select_node->next_node;
-                            } else {
-                                prev_node->next_node = select_node->next_node;
-                            }
-
-                            // Уменьшаем счетчик узлов выделенной цепочки.
-                            --select_chain->nodes_count;
-                            // Уменьшаем счетчик узлов хэш-мультиотображения.
-                            --_hash_multimap->nodes_count;
-
-                            // Если задана функция удаления для ключа.
-                            if (_del_key != NULL)
-                            {
-                                _del_key(select_node->key);
-                            }
-
-                            // Если задана функция удаления для данных.
-                            if (_del_data != NULL)
-                            {
-                                _del_data(select_node->data);
-                            }
-
-                            // Освобождаем из-под узла память.
-                            free(select_node);
-
-                            // Если цепочка опустела, удаляем ее.
-                            if (select_chain->nodes_count == 0)
-                            {
-                                // Ампутация из слота.
-                                if (prev_chain == NULL)
-                                {
-                                    _hash_multimap->slots[presented_k_hash] = select_chain->next_chain;
-                                } else {
-                                    prev_chain->next_chain = select_chain->next_chain;
-                                }
-
-                                // Уменьшаем счетчик цепочек хэш-мультиотображения.
-                                --_hash_multimap->chains_count;
-
-                                // Освобождаем из-под цепочки память.
-                                free(select_chain);
-                            }
-
-                            return 1;
-                        }
-                        prev_node = select_node;
-                        select_node = select_node->next_node;
-                    }
-                }
-            }
-            prev_chain = select_chain;
-            select_chain = select_chain->next_chain;
-        }
-    }
-
-    return 0;
-}
-
-// Удаляет из хэш-мультиотображения все пары с заданным ключом.
-// Возвращает количество удаленных пар.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-// Поскольку функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_erase_all(c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 void (*const _del_key)(void *const _key),
-                                 void (*const _del_data)(void *const _data),
-                                 size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-    if (_key == NULL)
-    {
-        error_set(_error, 2);
-        return 0;
-    }
-
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    // Если в нужном слоте имеются цепочки.
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        // Макросы дублирования кода для исключения проверок из циклов.
-
-        // Открытие циклов.
-        #define C_HASH_MULTIMAP_ERASE_ALL_BEGIN\
-        /* Перебираем цепочки в поисках такой, которая хранит узлы с аналогичным ключом */\
-        c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash],\
-                              *prev_chain = NULL;\
-        while (select_chain != NULL)\
-        {\
-            if (select_chain->k_hash == k_hash)\
-            {\
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)\
-                {\
-                    /* Обойдем все узлы цепочки и удалим их */\
-                    c_hash_multimap_node *select_node = select_chain->head,\
-                                         *delete_node;\
-                    while (select_node != NULL)\
-                    {\
-                        delete_node = select_node;\
-                        select_node = select_node->next_node;
-
-        // Закрытие циклов.
-        #define C_HASH_MULTIMAP_ERASE_ALL_END\
-                        free(delete_node);\
-                    }\
-                    /* Ампутируем цепочку */\
-                    if (prev_chain == NULL)\
-                    {\
-                        _hash_multimap->slots[presented_k_hash] = select_chain->next_chain;\
-                    } else {\
-                        prev_chain->next_chain = select_chain->next_chain;\
-                    }\
-                    /* Уменьшаем счетчик цепочек хэш-мультиотображения */\
-                    --_hash_multimap->chains_count;\
-                    /* Уменьшаем счетчик узлов хэш-мультиотображения на количество узлов удаляемой цепочки */\
-                    _hash_multimap->nodes_count -= select_chain->nodes_count;\
-                    /* Запоминаем количество удаленных пар. */\
-                    const size_t count = select_chain->nodes_count;\
-                    /* Освобождаем память */\
-                    free(select_chain);\
-                    return count;\
-                }\
-            }\
-            prev_chain = select_chain;\
-            select_chain = select_chain->next_chain;\
-        }
-
-        if (_del_key != NULL)
-        {
-            if (_del_data != NULL)
-            {
-                C_HASH_MULTIMAP_ERASE_ALL_BEGIN
-
-                _del_key(delete_node->key);
-                _del_data(delete_node->data);
-
-                C_HASH_MULTIMAP_ERASE_ALL_END
-            } else {
-                C_HASH_MULTIMAP_ERASE_ALL_BEGIN
-
-                _del_key(delete_node->key);
-
-                C_HASH_MULTIMAP_ERASE_ALL_END
-            }
-        } else {
-            if (_del_data != NULL)
-            {
-                C_HASH_MULTIMAP_ERASE_ALL_BEGIN
-
-                _del_data(delete_node->data);
-
-                C_HASH_MULTIMAP_ERASE_ALL_END
-            } else {
-                C_HASH_MULTIMAP_ERASE_ALL_BEGIN
-
-                C_HASH_MULTIMAP_ERASE_ALL_END
-            }
-        }
-
-        #undef C_HASH_MULTIMAP_ERASE_ALL_BEGIN
-        #undef C_HASH_MULTIMAP_ERASE_ALL_END
-    }
-
-    return 0;
-}
-
-// Обход всеъ пар хэш-мультиотображения и выполнение над ключами и данными пар заданных действий.
-// Должно быть задано действие хотя бы для ключа, или хотя бы для данных.
-// Ключи нельзя удалять и менять.
-// Данные нельзя удалять, но можно менять.
-// В случае успеха возвращает > 0.
-// Если в хэш-мультиотображении нет пар, возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_for_each(c_hash_multimap *const _hash_multimap,
-                                   void (*const _action_key)(const void *const _key),
-                                   void (*const _action_data)(void *const _data))
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-
-    if ( (_action_key == NULL) && (_action_data == NULL) )
-    {
-        return -2;
-    }
-
-    size_t count = _hash_multimap->chains_count;
-
-    // Макросы дублирования кода для избавления от проверок внутри циклов.
-
-    // Открытие циклов.
-    #define C_HASH_MULTIMAP_FOR_EACH_BEGIN\
-    for (size_t s = 0; (s < _hash_multimap->slots_count)&&(count > 0); ++s)\
-    {\
-        if (_hash_multimap->slots[s] != NULL)\
-        {\
-            c_hash_multimap_chain *select_chain = _hash_multimap->slots[s];\
-            while (select_chain != NULL)\
-            {\
-                c_hash_multimap_node *select_node = select_chain->head;\
-                while (select_node != NULL)\
-                {
-
-    // Закрытие циклов.
-    #define C_HASH_MULTIMAP_FOR_EACH_END\
-                    select_node = select_node->next_node;\
-                }\
-                select_chain = select_chain->next_chain;\
-                --count;\
-            }\
-        }\
-    }
-
-    if ( (_action_key != NULL) && (_action_data != NULL) )
-    {
-        // Заданы оба действия.
-        C_HASH_MULTIMAP_FOR_EACH_BEGIN
-
-        _action_key(select_node->key);
-        _action_data(select_node->data);
-
-        C_HASH_MULTIMAP_FOR_EACH_END
-    } else {
-        if (_action_key != NULL)
-        {
-            // Задано действие только для ключей.
-            C_HASH_MULTIMAP_FOR_EACH_BEGIN
-
-            _action_key(select_node->key);
-
-            C_HASH_MULTIMAP_FOR_EACH_END
-        } else {
-            // Задано действие только для данных.
-            C_HASH_MULTIMAP_FOR_EACH_BEGIN
-
-            _action_data(select_node->data);
-
-            C_HASH_MULTIMAP_FOR_EACH_END
-        }
-    }
-
-    #undef C_HASH_MULTIMAP_FOR_EACH_BEGIN
-    #undef C_HASH_MULTIMAP_FOR_EACH_END
-
-    return 1;
-}
-
-// Проверяет, есть ли такой ключ в хэш-мультиотображении.
-// Если есть, возвращает > 0.
-// Если нет, возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_key_check(const c_hash_multimap *const _hash_multimap,
-                                    const void *const _key)
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-    if (_key == NULL)
-    {
-        return -2;
-    }
-
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        const c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    return 1;
-                }
-            }
-            select_chain = select_chain->next_chain;
-        }
-    }
-
-    return 0;
-}
-
-// Возвращает количество пар с заданным ключом в хэш-мультиотображении.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_key_count(const c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-
-    if (_key == NULL)
-    {
-        error_set(_error, 2);
-        return 0;
-    }
-
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш искомого ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш искомого ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        const c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    return select_chain->nodes_count;
-                }
-            }
-            select_chain = select_chain->next_chain;
-        }
-    }
-
-    return 0;
-}
-
-// Проверка наличия заданной пары в хэш-мультиотображении.
-// В случае наличия пары возвращает > 0.
-// В случае отсутствия пары возвращает 0.
-// В случае ошибки возвращает < 0.
-ptrdiff_t c_hash_multimap_pair_check(const c_hash_multimap *const _hash_multimap,
-                                     const void *const _key,
-                                     const void *const _data)
-{
-    if (_hash_multimap == NULL)
-    {
-        return -1;
-    }
-    if (_key == NULL)
-    {
-        return -2;
-    }
-    if (_data == NULL)
-    {
-        return -3;
-    }
-
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        const c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    const c_hash_multimap_node *select_node = select_chain->head;
-                    while (select_node != NULL)
-                    {
-                        if (_hash_multimap->comp_data(select_node->data, _data) > 0)
-                        {
-                            return 1;
-                        }
-                        select_node = select_node->next_node;
-                    }
-                }
-            }
-            select_chain = select_chain->next_chain;
-        }
-    }
-    return 0;
-}
-
-// Возвращает количество пар с заданным ключем и данными.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки(> 0).
-// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_pair_count(const c_hash_multimap *const _hash_multimap,
-                                  const void *const _key,
-                                  const void *const _data,
-                                  size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-    if (_key == NULL)
-    {
-        error_set(_error, 2);
-        return 0;
-    }
-    if (_data == NULL)
-    {
-        error_set(_error, 3);
-        return 0;
-    }
-
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return 0;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        const c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    size_t count = 0;
-                    const c_hash_multimap_node *select_node = select_chain->head;
-                    while (select_node != NULL)
-                    {
-                        if (_hash_multimap->comp_data(select_node->data, _data) > 0)
-                        {
-                            ++count;
-                        }
-                        select_node = select_node->next_node;
-                    }
-                    return count;
-                }
-            }
-            select_chain = select_chain->next_chain;
-        }
-    }
-    return 0;
-}
-
-// Возвращает массив с указателями на все данные, связанные с заданным ключом.
-// Массив "нультерминирован", последним указателем является NULL.
-// Если в хэш-мультиотображении нет пар с заданным ключом, функция возвращает NULL.
-// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-// Так как функция может возвращать NULL и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-// Возвращаемый массив необходимо удалять при помощи free().
-void** c_hash_multimap_datas(c_hash_multimap *const _hash_multimap,
-                             const void *const _key,
-                             size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return NULL;
-    }
-    if (_key == NULL)
-    {
-        error_set(_error, 2);
-        return NULL;
-    }
-    if (_hash_multimap->nodes_count == 0)
-    {
-        return NULL;
-    }
-
-    // Неприведенный хэш ключа.
-    const size_t k_hash = _hash_multimap->hash_key(_key);
-
-    // Приведенный хэш ключа.
-    const size_t presented_k_hash = k_hash % _hash_multimap->slots_count;
-
-    if (_hash_multimap->slots[presented_k_hash] != NULL)
-    {
-        // Ищем в слоте цепочку, которая хранит узлы с заданным ключом.
-        const c_hash_multimap_chain *select_chain = _hash_multimap->slots[presented_k_hash];
-        while (select_chain != NULL)
-        {
-            if (select_chain->k_hash == k_hash)
-            {
-                if (_hash_multimap->comp_key(select_chain->head->key, _key) > 0)
-                {
-                    break;
-                }
-            }
-
-            select_chain = select_chain->next_chain;
-        }
-
-        // Если в слоте есть цепочка, которая хранит узлы с заданным ключом.
-        if (select_chain != NULL)
-        {
-            // Определяем, сколько в массиве должно быть указателей.
-            const size_t datas_count = select_chain->nodes_count + 1;
-            // Контролируем переполнение.
-            if (datas_count == 0)// Не, ну а вдруг...)
-            {
-                error_set(_error, 3);
-                return NULL;
-            }
-            // Определяем размер массива
-            const size_t datas_size = datas_count * sizeof(void*);
-            // Контролируем переполнение.
-            if ( (datas_size == 0) ||
-                 (datas_size / datas_count != sizeof(void*)) )
-            {
-                error_set(_error, 4);
-                return NULL;
-            }
-
-            // Пытаемся выделить память.
-            void **new_datas = malloc(datas_size);
-            // Контролируем успешность выделения памяти,
-            if (new_datas == NULL)
-            {
-                error_set(_error, 5);
-                return NULL;
-            }
-            // Заполняем.
-            size_t index = 0;
-            const c_hash_multimap_node *select_node = select_chain->head;
-            while (select_node != NULL)
-            {
-                new_datas[index] = select_node->data;
-                select_node = select_node->next_node;
-                ++index;
-            }
-            // Ставим в конце массива отметку.
-            new_datas[index] = NULL;
-
-            return new_datas;
-        }
-    }
-
-    return NULL;
-}
-
-// Возвращает количество слотов хэш-мультиотображения.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функций необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_slots_count(const c_hash_multimap *const _hash_multimap,
-                                   size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-
-    return _hash_multimap->slots_count;
-}
-
-// Возвращает количество цепочек в хэш-мультимножестве.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
-// код причины ошибки (> 0).
-// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_unique_keys_count(const c_hash_multimap *const _hash_multimap,
-                                         size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-
-    return _hash_multimap->chains_count;
-}
-
-// Возвращает количество узлов в хэш-мультимножестве.
-// В случае ошибки возвращает 0, и если _error != NULL, в заданое расположение помещается
-// код причины ошибки (> 0).
-// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
-// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
-size_t c_hash_multimap_pairs_count(const c_hash_multimap *const _hash_multimap,
-                                   size_t *const _error)
-{
-    if (_hash_multimap == NULL)
-    {
-        error_set(_error, 1);
-        return 0;
-    }
-
-    return _hash_multimap->nodes_count;
-}
+﻿/*
+    Файл реализации хэш-мультиотображения c_hash_multimap
+    Разработка, отладка и сборка производилась в:
+    ОС: Windows 10/x64
+    IDE: Code::Blocks 17.12
+    Компилятор: default Code::Blocks 17.12 MinGW
+    Разработчик: Глухманюк Максим
+    Эл. почта: mgneo@yandex.ru
+    Место: Российская Федерация, Самарская область, Сызрань
+    Дата: 11.04.2018
+    Лицензия: GPLv3
+*/
+
+// pthread_rwlock_t в строгом режиме C99 объявляется, только если запрошен POSIX.1-2001.
+#if defined(C_HASH_MULTIMAP_THREADS) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <memory.h>
+#include <string.h>
+
+#include "c_hash_multimap.h"
+
+// Одновременный доступ из нескольких потоков (POSIX threads) доступен, только если
+// определен C_HASH_MULTIMAP_THREADS.
+#if defined(C_HASH_MULTIMAP_THREADS)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+
+    // Чтение поля, которое писатели изменяют, не блокируя читателей.
+    #define C_HASH_MULTIMAP_LOAD(_field) __atomic_load_n(&(_field), __ATOMIC_ACQUIRE)
+    // Изменение поля, видимого читателям без блокировок: все предшествующие записи
+    // становятся видны раньше нового значения.
+    #define C_HASH_MULTIMAP_STORE(_field, _value) __atomic_store_n(&(_field), (_value), __ATOMIC_RELEASE)
+#else
+    #define C_HASH_MULTIMAP_LOAD(_field) (_field)
+    #define C_HASH_MULTIMAP_STORE(_field, _value) ( (_field) = (_value) )
+#endif
+
+// Счетчики поисков, проб и вызовов функций сравнения (c_hash_multimap_stats()) ведутся, только если
+// определен C_HASH_MULTIMAP_COUNTERS. Иначе их увеличение ничего не стоит.
+#if defined(C_HASH_MULTIMAP_COUNTERS)
+    #if defined(C_HASH_MULTIMAP_THREADS)
+        #define C_HASH_MULTIMAP_COUNT(_hash_multimap, _counter, _value)\
+            ( (void)__atomic_fetch_add(&((c_hash_multimap*)(_hash_multimap))->_counter, (_value), __ATOMIC_RELAXED) )
+    #else
+        #define C_HASH_MULTIMAP_COUNT(_hash_multimap, _counter, _value)\
+            ( (void)(((c_hash_multimap*)(_hash_multimap))->_counter += (_value)) )
+    #endif
+#else
+    #define C_HASH_MULTIMAP_COUNT(_hash_multimap, _counter, _value) ( (void)0 )
+#endif
+
+// Ширина группы управляющих байтов, просматриваемой открытой адресацией за одно сравнение.
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define C_HASH_MULTIMAP_AVX2
+    #define C_HASH_MULTIMAP_GROUP ( (size_t) 32 )
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define C_HASH_MULTIMAP_SSE2
+    #define C_HASH_MULTIMAP_GROUP ( (size_t) 16 )
+#else
+    // Без SIMD группа обрабатывается как одно 64-битное слово.
+    #define C_HASH_MULTIMAP_GROUP ( (size_t) 8 )
+#endif
+
+// Количество слотов, задаваемое хэш-мультиотображению с нулем слотов при автоматическом
+// расширении.
+#define C_HASH_MULTIMAP_0 ( (size_t) 1024 )
+
+// Минимально возможное значение max_load_factor.
+#define C_HASH_MULTIMAP_MLF_MIN ( (float) 0.01f )
+
+// Максимально возможное значение max_load_factor.
+#define C_HASH_MULTIMAP_MLF_MAX ( (float) 1.f )
+
+// Размер страницы пула (в байтах) по умолчанию.
+#define C_HASH_MULTIMAP_POOL_PAGE ( (size_t) 16384 )
+
+// Предельная загруженность таблицы открытой адресации, max_load_factor выше не применяется.
+#define C_HASH_MULTIMAP_OPEN_MLF ( (float) 0.875f )
+
+// Управляющий байт пустого слота открытой адресации.
+#define C_HASH_MULTIMAP_CTRL_EMPTY ( (uint8_t) 0x80 )
+
+// Управляющий байт слота, из которого цепочка была удалена (надгробие).
+// Занятый слот хранит 7-битную метку хэша, старший бит которой равен 0.
+#define C_HASH_MULTIMAP_CTRL_DELETED ( (uint8_t) 0xFE )
+
+// Количество классов вместимости массивов данных, выделяемых из пулов.
+// Массивы вместимостью 1, 2, 4, ..., 2^(C_HASH_MULTIMAP_VALUES_CLASSES - 1) берутся из пулов,
+// массивы большей вместимости запрашиваются у распределителя напрямую.
+#define C_HASH_MULTIMAP_VALUES_CLASSES ( (size_t) 6 )
+
+// Количество пар, которые пакетные операции обрабатывают за один проход: сначала вычисляются хэши
+// всех ключей прохода, затем ключи обрабатываются с опережающей подкачкой.
+#define C_HASH_MULTIMAP_BATCH ( (size_t) 64 )
+
+// На сколько ключей вперед пакетные операции подкачивают слоты.
+// Цепочки подкачиваются вдвое ближе, когда слоты уже должны быть в кэше.
+#define C_HASH_MULTIMAP_PREFETCH_DISTANCE ( (size_t) 8 )
+
+// Подсказка процессору загрузить в кэш память по заданному адресу.
+#if defined(__GNUC__)
+    #define C_HASH_MULTIMAP_PREFETCH(_address) __builtin_prefetch(_address)
+#else
+    #define C_HASH_MULTIMAP_PREFETCH(_address) ( (void) (_address) )
+#endif
+
+// Размер строки кэша, на которые разносятся блокировки полос.
+#define C_HASH_MULTIMAP_CACHE_LINE ( (size_t) 64 )
+
+// Количество цепочек, указатели и метки которых хранит корзина: вместе с указателем на продолжение
+// списка и счетчиком они занимают не больше строки кэша.
+#define C_HASH_MULTIMAP_BUCKET_ENTRIES\
+    ( (C_HASH_MULTIMAP_CACHE_LINE - sizeof(void*) - 1) / (sizeof(void*) + 1) )
+
+// Метка хэша цепочки в корзине - старшие биты произведения хэша на нечетную константу: они зависят
+// от всех битов хэша. Младшие биты хэша определяют слот, а старшие - шард, поэтому метка, взятая
+// из самого хэша, совпадала бы у всех цепочек шарда, а у слабых функций хэша была бы нулевой.
+#define C_HASH_MULTIMAP_BUCKET_TAG(_k_hash) ( (uint8_t)(((uint64_t)(_k_hash) * 0x9E3779B97F4A7C15u) >> 56) )
+
+// Во сколько раз больше пустых старых слотов, чем непустых, может просмотреть за один шаг
+// постепенное перестроение.
+#define C_HASH_MULTIMAP_REHASH_VISITS ( (size_t) 10 )
+
+// Количество ампутированных объектов, при накоплении которого писатель пытается продвинуть эпоху
+// и освободить объекты, которые уже не просматривает ни один читатель без блокировок.
+#define C_HASH_MULTIMAP_RETIRED_BATCH ( (size_t) 64 )
+
+// Количество слотов в одном диапазоне параллельного обхода.
+#define C_HASH_MULTIMAP_PARALLEL_RANGE ( (size_t) 4096 )
+
+// Максимальное количество потоков встроенного пула параллельного обхода.
+#define C_HASH_MULTIMAP_WORKERS_MAX ( (size_t) 64 )
+
+// Максимальное количество шардов хэш-мультиотображения с шардами.
+#define C_HASH_MULTIMAP_SHARDS_MAX ( (size_t) 1024 )
+
+// Версия формата файла снимка (c_hash_multimap_save(), c_hash_multimap_load()) и образа
+// замороженного хэш-мультиотображения (c_hash_multimap_freeze()).
+#define C_HASH_MULTIMAP_FILE_VERSION ( (uint8_t) 1 )
+
+// Размер сигнатуры файла: "CHMM" (снимок) или "CHMF" (образ), версия формата, sizeof(size_t)
+// и два нулевых байта.
+#define C_HASH_MULTIMAP_FILE_SIGNATURE ( (size_t) 8 )
+
+// Количество полей size_t в заголовке файла снимка после сигнатуры: значение для проверки порядка
+// байтов, key_size, key_string, hash_finalizer, количество цепочек, пар и слотов.
+#define C_HASH_MULTIMAP_FILE_FIELDS ( (size_t) 7 )
+
+// Значение первого поля заголовка файла снимка, по которому проверяется порядок байтов.
+#define C_HASH_MULTIMAP_FILE_ORDER ( (size_t) 0x01020304 )
+
+// Количество полей size_t в заголовке образа замороженного хэш-мультиотображения после сигнатуры:
+// значение для проверки порядка байтов, key_size, key_string, hash_finalizer, количество слотов,
+// цепочек и пар, размер образа.
+#define C_HASH_MULTIMAP_FROZEN_FIELDS ( (size_t) 8 )
+
+// Количество полей size_t в записи цепочки образа: хэш ключа, смещение ключа, индекс первых
+// данных цепочки в массиве смещений данных и количество данных.
+#define C_HASH_MULTIMAP_FROZEN_CHAIN ( (size_t) 4 )
+
+// Выравнивание (в байтах) ключей и данных в образе.
+#define C_HASH_MULTIMAP_FROZEN_ALIGN ( (size_t) 8 )
+
+// Размер буфера записи образа (в байтах).
+#define C_HASH_MULTIMAP_WRITER_SIZE ( (size_t) 8192 )
+
+// Количество данных ключа, до которого c_hash_multimap_stats() вычисляет процентиль точно.
+#define C_HASH_MULTIMAP_STATS_EXACT ( (size_t) 256 )
+
+// Виды ампутированных объектов.
+// Цепочка вместе с массивом данных.
+#define C_HASH_MULTIMAP_RETIRED_CHAIN ( (size_t) 0 )
+// Массив данных.
+#define C_HASH_MULTIMAP_RETIRED_VALUES ( (size_t) 1 )
+// Данные пользователя.
+#define C_HASH_MULTIMAP_RETIRED_DATA ( (size_t) 2 )
+// Описание опубликованных слотов вместе со слотами.
+#define C_HASH_MULTIMAP_RETIRED_TABLE ( (size_t) 3 )
+
+typedef struct s_c_hash_multimap_values c_hash_multimap_values;
+
+typedef struct s_c_hash_multimap_chain c_hash_multimap_chain;
+
+typedef struct s_c_hash_multimap_page c_hash_multimap_page;
+
+typedef struct s_c_hash_multimap_pool c_hash_multimap_pool;
+
+typedef struct s_c_hash_multimap_place c_hash_multimap_place;
+
+typedef struct s_c_hash_multimap_bucket c_hash_multimap_bucket;
+
+typedef struct s_c_hash_multimap_table c_hash_multimap_table;
+
+typedef struct s_c_hash_multimap_reader c_hash_multimap_reader;
+
+typedef struct s_c_hash_multimap_retired c_hash_multimap_retired;
+
+typedef struct s_c_hash_multimap_job c_hash_multimap_job;
+
+typedef struct s_c_hash_multimap_worker c_hash_multimap_worker;
+
+typedef struct s_c_hash_multimap_writer c_hash_multimap_writer;
+
+// Массив данных, связанных с одним ключом.
+// Вместимость всегда является степенью двойки.
+struct s_c_hash_multimap_values
+{
+    size_t count,
+           capacity;
+
+    void *datas[];
+};
+
+// Цепочка хранит ключ и все связанные с ним данные.
+struct s_c_hash_multimap_chain
+{
+    c_hash_multimap_chain *next_chain;
+
+    void *key;
+    size_t k_hash;
+
+    c_hash_multimap_values *values;
+};
+
+// Заголовок страницы пула, за ним в той же памяти располагаются объекты.
+struct s_c_hash_multimap_page
+{
+    c_hash_multimap_page *next_page;
+
+    // Полный размер страницы вместе с заголовком.
+    size_t size;
+};
+
+// Пул объектов одного размера.
+// Память запрашивается у распределителя страницами, освобожденные объекты попадают в список
+// свободных и выдаются повторно. Страницы возвращаются распределителю только при очистке пула.
+struct s_c_hash_multimap_pool
+{
+    c_hash_multimap_page *pages;
+
+    // Список свободных объектов, первые байты свободного объекта хранят указатель на следующий.
+    void *free_list;
+
+    // Еще не выданная часть последней страницы.
+    char *bump,
+         *bump_end;
+
+    size_t object_size,
+           page_size;
+};
+
+// Место цепочки в слотах, необходимое для ее ампутации.
+struct s_c_hash_multimap_place
+{
+    // Индекс слота.
+    size_t index;
+
+    // Предыдущая цепочка слота (только для механизма цепочек).
+    c_hash_multimap_chain *prev_chain;
+
+    // Слоты, которым принадлежит цепочка: текущие или старые слоты постепенного перестроения
+    // (только для механизма цепочек).
+    c_hash_multimap_chain **slots;
+};
+
+// Слот механизма корзин, занимает строку кэша.
+// Корзина служит указателем на начало списка цепочек слота, таким же, как слот механизма цепочек,
+// и дополнительно хранит указатели и метки первых цепочек списка, поэтому обходы просматривают
+// список как обычно, а поиск сравнивает с ключом только цепочки с совпавшей меткой.
+struct s_c_hash_multimap_bucket
+{
+    // Первые count цепочек списка, entries[0] - начало списка, остальные равны NULL.
+    c_hash_multimap_chain *entries[C_HASH_MULTIMAP_BUCKET_ENTRIES];
+    // Цепочка, следующая за entries[C_HASH_MULTIMAP_BUCKET_ENTRIES - 1], NULL - продолжения нет.
+    c_hash_multimap_chain *overflow;
+
+    // Метки хэшей цепочек entries.
+    uint8_t tags[C_HASH_MULTIMAP_BUCKET_ENTRIES];
+    uint8_t count;
+};
+
+// Корзины индексируются с шагом в строку кэша (slot_shift), а таблица корзин выравнивается на ее размер,
+// поэтому корзина не должна превышать строку кэша, иначе соседние корзины перекрывались бы.
+// Если условие нарушено, размер массива отрицателен и сборка завершается ошибкой.
+typedef char c_hash_multimap_bucket_check[(sizeof(c_hash_multimap_bucket) <= C_HASH_MULTIMAP_CACHE_LINE) ? 1 : -1];
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+// Слоты, опубликованные для читателей без блокировок.
+// Указатель на слоты и их количество публикуются вместе, поэтому описание после публикации не изменяется.
+struct s_c_hash_multimap_table
+{
+    c_hash_multimap_chain **slots;
+    size_t slots_count;
+};
+
+// Запись потока, читающего без блокировок.
+// Записи создаются при первом чтении потока и освобождаются вместе с хэш-мультиотображением.
+struct s_c_hash_multimap_reader
+{
+    // Эпоха, в которой поток начал чтение, сдвинутая на один бит влево, с единицей в младшем бите.
+    // 0 - поток не читает.
+    size_t epoch;
+    // Вложенность чтений (изменяется только потоком-владельцем).
+    size_t depth;
+
+    pthread_t owner;
+
+    c_hash_multimap_reader *next_reader;
+};
+
+// Объект, ампутированный писателем, который еще могут просматривать читатели без блокировок.
+struct s_c_hash_multimap_retired
+{
+    c_hash_multimap_retired *next_retired;
+
+    // Глобальная эпоха на момент ампутации.
+    size_t epoch;
+
+    // Вид объекта (C_HASH_MULTIMAP_RETIRED_*).
+    size_t kind;
+    void *object;
+
+    // Функции удаления, вызываемые перед освобождением цепочки или для данных.
+    void (*del_key)(void *const _key);
+    void (*del_data)(void *const _data);
+};
+#endif
+
+struct s_c_hash_multimap
+{
+    // Функция генерации хэша по ключу.
+    size_t (*hash_key)(const void *const _key);
+
+    // Функция детального сравнения ключей.
+    // В случае идентичности ключей должна возвращать > 0.
+    size_t (*comp_key)(const void *const _key_a,
+                       const void *const _key_b);
+    // Функция детального сравнения данных.
+    // В случае идентичности данных должна возвращать > 0.
+    size_t (*comp_data)(const void *const _data_a,
+                        const void *const _data_b);
+    // Функция генерации хэша по данным, NULL - массивы данных не индексируются.
+    size_t (*hash_data)(const void *const _data);
+    // Вместимость, с которой массив данных индексируется, SIZE_MAX - не индексируется.
+    size_t data_index_capacity;
+
+    // nodes_count - количество пар.
+    size_t slots_count,
+           chains_count,
+           nodes_count;
+
+    float max_load_factor;
+    // Загруженность, ниже которой слоты автоматически уменьшаются, 0 - не уменьшаются.
+    float min_load_factor;
+
+    // Количество слотов всегда является степенью двойки.
+    size_t pow2_slots;
+    // Хэш ключа перемешивается финализатором.
+    size_t hash_finalizer;
+
+    // Размер ключей, хранящихся внутри цепочек сразу за ними, 0 - цепочки хранят указатели на ключи
+    // вызывающего.
+    size_t key_size;
+    // Ключи, хранящиеся внутри цепочек, являются строками, завершенными нулем.
+    size_t key_string;
+
+    // Механизм хранения.
+    size_t engine;
+    // Слот занимает 1 << slot_shift указателей: у механизма корзин слот является корзиной.
+    size_t slot_shift;
+
+    // Для механизма цепочек слот хранит связный список цепочек.
+    // Для открытой адресации слот хранит не более одной цепочки, пустые слоты и надгробия равны NULL.
+    c_hash_multimap_chain **slots;
+
+    // Управляющие байты открытой адресации, по одному на слот.
+    uint8_t *ctrl;
+
+    // Сколько еще цепочек можно разместить в пустых слотах открытой адресации без перестроения.
+    size_t growth_left;
+
+    // Количество старых слотов, переносимых за одну изменяющую операцию при постепенном
+    // перестроении (только для механизма цепочек), 0 - перестроение разом.
+    size_t rehash_step;
+    // Старые слоты постепенного перестроения, NULL - перестроение не выполняется.
+    c_hash_multimap_chain **rehash_slots;
+    size_t rehash_slots_count;
+    // Индекс первого старого слота, цепочки которого еще не перенесены.
+    size_t rehash_index;
+
+    c_hash_multimap_allocator allocator;
+
+    c_hash_multimap_pool chains_pool;
+
+    // Пулы массивов данных, по одному на класс вместимости.
+    c_hash_multimap_pool values_pools[C_HASH_MULTIMAP_VALUES_CLASSES];
+
+    // Количество массивов данных, выделенных не из пулов.
+    size_t values_large;
+
+    // Количество перестроений слотов.
+    size_t resizes_count;
+#if defined(C_HASH_MULTIMAP_COUNTERS)
+    // Количество поисков цепочек, просмотренных ими цепочек и вызовов функций сравнения.
+    size_t lookups,
+           probes,
+           key_comparisons,
+           data_comparisons;
+#endif
+
+    // Вместимость массивов данных, выделяемых следующим values_hint_left новым цепочкам
+    // (задается резервированием).
+    size_t values_hint_capacity,
+           values_hint_left;
+
+    // Количество полос блокировок, 0 - хэш-мультиотображение не защищено от одновременного доступа.
+    size_t stripes_count;
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Блокировки чтения-записи полос, каждая занимает stripe_size байт.
+    // Полоса ключа определяется младшими битами хэша, которые при количестве слотов, являющемся
+    // степенью двойки и не меньшем количества полос, определяют и младшие биты индекса слота.
+    // Поэтому все цепочки одного слота принадлежат одной полосе при любом количестве слотов.
+    char *stripes;
+    size_t stripe_size;
+
+    // Блокировка пулов, распределителя и счетчиков, общих для всех полос.
+    pthread_mutex_t heap_lock;
+
+    // Читатели не блокируют полосы, а объявляют эпоху в записях readers, ампутированные объекты
+    // освобождаются, когда их заведомо не просматривает ни один читатель.
+    size_t lock_free_reads;
+    // Уникальный идентификатор хэш-мультиотображения, по которому поток находит свою запись читателя.
+    size_t id;
+    // Слоты, опубликованные для читателей, NULL - слотов нет.
+    c_hash_multimap_table *table;
+    // Нечетное значение - цепочки переносятся в новые слоты, и промах поиска недостоверен.
+    size_t slots_seq;
+    // Глобальная эпоха.
+    size_t epoch;
+    c_hash_multimap_reader *readers;
+    // Ампутированные объекты, ожидающие освобождения, от новых к старым.
+    c_hash_multimap_retired *retired;
+    size_t retired_count;
+    c_hash_multimap_pool retired_pool;
+
+    // Наименьшее количество цепочек, при котором слоты перестраиваются параллельно, 0 - никогда.
+    size_t rebuild_parallel;
+    c_hash_multimap_executor rebuild_executor;
+#endif
+};
+
+// Хэш-мультиотображение с шардами.
+struct s_c_hash_multimap_sharded
+{
+    // Функция генерации хэша по ключу, общая для всех шардов.
+    size_t (*hash_key)(const void *const _key);
+
+    // Количество шардов, всегда является степенью двойки.
+    size_t shards_count;
+    // Шард ключа определяется старшими битами перемешанного хэша, а слот внутри шарда - младшими,
+    // поэтому ключи одного шарда распределяются по его слотам равномерно.
+    size_t shard_shift;
+
+    c_hash_multimap_allocator allocator;
+
+    c_hash_multimap *shards[];
+};
+
+// Параллельный обход слотов.
+// Слоты делятся на диапазоны по C_HASH_MULTIMAP_PARALLEL_RANGE, исполнители забирают их по одному
+// из общего счетчика, пока диапазоны не кончатся. Поэтому исполнитель, которому достались
+// короткие цепочки, забирает часть работы у остальных.
+struct s_c_hash_multimap_job
+{
+    c_hash_multimap *hash_multimap;
+    const c_hash_multimap_executor *executor;
+
+    // Количество диапазонов текущих слотов и всех диапазонов, включая старые слоты
+    // постепенного перестроения.
+    size_t slots_ranges,
+           ranges_count;
+    // Следующий незанятый диапазон.
+    size_t range_next;
+
+    // Действия обхода. Если они не заданы, обход удаляет цепочки: вызывает функции удаления
+    // и освобождает массивы данных, выделенные не из пулов.
+    void (*action_key)(const void *const _key, void *const _context, const size_t _worker);
+    void (*action_data)(void *const _data, void *const _context, const size_t _worker);
+    void (*del_key)(void *const _key, void *const _context, const size_t _worker);
+    void (*del_data)(void *const _data, void *const _context, const size_t _worker);
+    void *context;
+
+    // Количество освобожденных массивов данных, выделенных не из пулов.
+    size_t values_freed;
+
+    // Новые слоты параллельного перестроения.
+    c_hash_multimap_chain **new_slots;
+    size_t new_slots_count;
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Исполнители освобождают массивы данных через распределитель по очереди.
+    pthread_mutex_t heap_lock;
+#endif
+};
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+// Поток встроенного пула параллельного обхода.
+struct s_c_hash_multimap_worker
+{
+    c_hash_multimap_job *job;
+    void (*task)(void *const _job, const size_t _worker);
+    size_t worker;
+};
+#endif
+
+// Буфер записи образа замороженного хэш-мультиотображения: мелкие записи (записи цепочек,
+// смещения данных, ключи и данные) передаются в файл блоками.
+struct s_c_hash_multimap_writer
+{
+    FILE *file;
+    size_t used;
+    uint8_t bytes[C_HASH_MULTIMAP_WRITER_SIZE];
+};
+
+// Если расположение задано, в него помещается код.
+static void error_set(size_t *const _error,
+                      const size_t _code)
+{
+    if (_error != NULL)
+    {
+        *_error = _code;
+    }
+}
+
+// Финализатор хэша (fmix из MurmurHash3).
+// Каждый бит входа влияет на каждый бит результата.
+static inline size_t hash_finalize(size_t _hash)
+{
+#if SIZE_MAX > 0xFFFFFFFFu
+    _hash ^= _hash >> 33;
+    _hash *= (size_t)0xFF51AFD7ED558CCDu;
+    _hash ^= _hash >> 33;
+    _hash *= (size_t)0xC4CEB9FE1A85EC53u;
+    _hash ^= _hash >> 33;
+#else
+    _hash ^= _hash >> 16;
+    _hash *= (size_t)0x85EBCA6Bu;
+    _hash ^= _hash >> 13;
+    _hash *= (size_t)0xC2B2AE35u;
+    _hash ^= _hash >> 16;
+#endif
+    return _hash;
+}
+
+// Перемешивает 64-битное значение финализатором fmix64 из MurmurHash3 и приводит результат к size_t.
+// Каждый бит входа влияет на каждый бит результата.
+static inline size_t hash_mix(uint64_t _value)
+{
+    _value ^= _value >> 33;
+    _value *= 0xFF51AFD7ED558CCDu;
+    _value ^= _value >> 33;
+    _value *= 0xC4CEB9FE1A85EC53u;
+    _value ^= _value >> 33;
+#if SIZE_MAX > 0xFFFFFFFFu
+    return (size_t)_value;
+#else
+    return (size_t)(_value ^ (_value >> 32));
+#endif
+}
+
+// Встроенная функция хэша для ключей, хранящихся внутри цепочек.
+// Байты обрабатываются словами по 8: каждое слово смешивается с состоянием умножением,
+// а результат проходит финализатор fmix64, поэтому дополнительное перемешивание не требуется.
+// Остаток короче слова читается перекрывающимися чтениями постоянного размера (как в wyhash):
+// сборка слова из байтов переменной длины через стек не дает процессору перенаправить запись
+// в чтение и задерживает поиск до завершения всех предыдущих промахов кэша.
+static inline size_t hash_bytes(const void *const _bytes,
+                                const size_t _size)
+{
+    const uint8_t *bytes = _bytes;
+    uint64_t hash = (uint64_t)_size * 0x9E3779B97F4A7C15u;
+    size_t left = _size;
+    while (left >= sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(uint64_t));
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9u;
+        hash ^= hash >> 31;
+        bytes += sizeof(uint64_t);
+        left -= sizeof(uint64_t);
+    }
+    if (left > 0)
+    {
+        uint64_t word;
+        if (_size >= sizeof(uint64_t))
+        {
+            // Последние 8 байт, часть которых уже смешана.
+            memcpy(&word, bytes + left - sizeof(uint64_t), sizeof(uint64_t));
+        } else if (left >= sizeof(uint32_t))
+        {
+            uint32_t low, high;
+            memcpy(&low, bytes, sizeof(uint32_t));
+            memcpy(&high, bytes + left - sizeof(uint32_t), sizeof(uint32_t));
+            word = ( (uint64_t)high << 32 ) | low;
+        } else {
+            word = ( (uint64_t)bytes[0] << 16 ) | ( (uint64_t)bytes[left >> 1] << 8 ) | bytes[left - 1];
+        }
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9u;
+        hash ^= hash >> 31;
+    }
+
+    return hash_mix(hash);
+}
+
+// Вычисляет хэш ключа, хранящегося внутри цепочек, встроенной функцией.
+// Строка хэшируется без завершающего нуля.
+static inline size_t hash_inline(const c_hash_multimap *const _hash_multimap,
+                                 const void *const _key)
+{
+    if (_hash_multimap->key_string != 0)
+    {
+        return hash_bytes(_key, strlen(_key));
+    }
+    return hash_bytes(_key, _hash_multimap->key_size);
+}
+
+// Вычисляет неприведенный хэш ключа.
+static inline size_t hash_compute(const c_hash_multimap *const _hash_multimap,
+                                  const void *const _key)
+{
+    if (_hash_multimap->key_size != 0)
+    {
+        return hash_inline(_hash_multimap, _key);
+    }
+
+    const size_t k_hash = _hash_multimap->hash_key(_key);
+    if (_hash_multimap->hash_finalizer != 0)
+    {
+        return hash_finalize(k_hash);
+    }
+    return k_hash;
+}
+
+// Приводит хэш к заданному количеству слотов.
+static inline size_t hash_present(const c_hash_multimap *const _hash_multimap,
+                                  const size_t _k_hash,
+                                  const size_t _slots_count)
+{
+    if (_hash_multimap->pow2_slots != 0)
+    {
+        return _k_hash & (_slots_count - 1);
+    }
+    return _k_hash % _slots_count;
+}
+
+// Округляет количество слотов вверх до степени двойки.
+// В случае переполнения возвращает 0.
+static size_t pow2_round(const size_t _slots_count)
+{
+    size_t result = 1;
+    while (result < _slots_count)
+    {
+        result <<= 1;
+        if (result == 0)
+        {
+            return 0;
+        }
+    }
+    return result;
+}
+
+// Распределитель по умолчанию, выделение памяти.
+static void *default_alloc(void *const _context,
+                           const size_t _size)
+{
+    (void)_context;
+    return malloc(_size);
+}
+
+// Распределитель по умолчанию, освобождение памяти.
+static void default_free(void *const _context,
+                         void *const _memory,
+                         const size_t _size)
+{
+    (void)_context;
+    (void)_size;
+    free(_memory);
+}
+
+// Выделяет память через распределитель хэш-мультиотображения.
+static void *memory_alloc(const c_hash_multimap *const _hash_multimap,
+                          const size_t _size)
+{
+    return _hash_multimap->allocator.alloc(_hash_multimap->allocator.context, _size);
+}
+
+// Освобождает память через распределитель хэш-мультиотображения.
+static void memory_free(const c_hash_multimap *const _hash_multimap,
+                        void *const _memory,
+                        const size_t _size)
+{
+    if (_memory != NULL)
+    {
+        _hash_multimap->allocator.free(_hash_multimap->allocator.context, _memory, _size);
+    }
+}
+
+// Блокирует полосу заданного хэша на чтение (_write == 0) или на запись.
+// Если хэш-мультиотображение не защищено от одновременного доступа, ничего не делает.
+static inline void stripe_lock(const c_hash_multimap *const _hash_multimap,
+                               const size_t _k_hash,
+                               const size_t _write)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        pthread_rwlock_t *const lock = (pthread_rwlock_t*)(_hash_multimap->stripes +
+                                       (_k_hash & (_hash_multimap->stripes_count - 1)) * _hash_multimap->stripe_size);
+        if (_write != 0)
+        {
+            pthread_rwlock_wrlock(lock);
+        } else {
+            pthread_rwlock_rdlock(lock);
+        }
+    }
+#else
+    (void)_hash_multimap;
+    (void)_k_hash;
+    (void)_write;
+#endif
+}
+
+// Снимает блокировку полосы заданного хэша.
+static inline void stripe_unlock(const c_hash_multimap *const _hash_multimap,
+                                 const size_t _k_hash)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        pthread_rwlock_unlock((pthread_rwlock_t*)(_hash_multimap->stripes +
+                              (_k_hash & (_hash_multimap->stripes_count - 1)) * _hash_multimap->stripe_size));
+    }
+#else
+    (void)_hash_multimap;
+    (void)_k_hash;
+#endif
+}
+
+// Блокирует все полосы на чтение (_write == 0) или на запись.
+// Полосы всегда блокируются по возрастанию индекса, поэтому поток, удерживающий одну полосу,
+// перед блокировкой всех должен ее освободить.
+static void stripes_lock(const c_hash_multimap *const _hash_multimap,
+                         const size_t _write)
+{
+    for (size_t s = 0; s < _hash_multimap->stripes_count; ++s)
+    {
+        stripe_lock(_hash_multimap, s, _write);
+    }
+}
+
+// Снимает блокировки всех полос.
+static void stripes_unlock(const c_hash_multimap *const _hash_multimap)
+{
+    for (size_t s = _hash_multimap->stripes_count; s > 0; --s)
+    {
+        stripe_unlock(_hash_multimap, s - 1);
+    }
+}
+
+// Блокирует пулы, распределитель и общие для всех полос счетчики.
+static inline void heap_lock(const c_hash_multimap *const _hash_multimap)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        pthread_mutex_lock((pthread_mutex_t*)&_hash_multimap->heap_lock);
+    }
+#else
+    (void)_hash_multimap;
+#endif
+}
+
+// Снимает блокировку пулов.
+static inline void heap_unlock(const c_hash_multimap *const _hash_multimap)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        pthread_mutex_unlock((pthread_mutex_t*)&_hash_multimap->heap_lock);
+    }
+#else
+    (void)_hash_multimap;
+#endif
+}
+
+// Счетчики цепочек и пар изменяются под блокировками разных полос, поэтому при одновременном
+// доступе к ним обращаются атомарно.
+
+// Увеличивает счетчик на заданное значение.
+static inline void counter_add(const c_hash_multimap *const _hash_multimap,
+                               size_t *const _counter,
+                               const size_t _value)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        __atomic_fetch_add(_counter, _value, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    *_counter += _value;
+}
+
+// Уменьшает счетчик на заданное значение.
+static inline void counter_sub(const c_hash_multimap *const _hash_multimap,
+                               size_t *const _counter,
+                               const size_t _value)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        __atomic_fetch_sub(_counter, _value, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    *_counter -= _value;
+}
+
+// Читает счетчик.
+static inline size_t counter_load(const c_hash_multimap *const _hash_multimap,
+                                  const size_t *const _counter)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        return __atomic_load_n(_counter, __ATOMIC_RELAXED);
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    return *_counter;
+}
+
+// Размер заголовка страницы пула с учетом выравнивания объектов.
+#define C_HASH_MULTIMAP_PAGE_HEADER\
+    ( (sizeof(c_hash_multimap_page) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*) )
+
+// Подготавливает пул к работе.
+static void pool_init(c_hash_multimap_pool *const _pool,
+                      const size_t _object_size,
+                      const size_t _page_size)
+{
+    _pool->pages = NULL;
+    _pool->free_list = NULL;
+    _pool->bump = NULL;
+    _pool->bump_end = NULL;
+    // Свободный объект хранит указатель, поэтому размер округляется до кратного sizeof(void*).
+    _pool->object_size = (_object_size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+    _pool->page_size = _page_size;
+}
+
+// Выделяет объект из пула.
+// В случае ошибки возвращает NULL.
+static void *pool_alloc(const c_hash_multimap *const _hash_multimap,
+                        c_hash_multimap_pool *const _pool)
+{
+    // Сначала используем освобожденные ранее объекты.
+    if (_pool->free_list != NULL)
+    {
+        void *const object = _pool->free_list;
+        _pool->free_list = *(void**)object;
+        return object;
+    }
+
+    // Если в последней странице не осталось места, запрашиваем новую.
+    if ((size_t)(_pool->bump_end - _pool->bump) < _pool->object_size)
+    {
+        c_hash_multimap_page *const new_page = memory_alloc(_hash_multimap, _pool->page_size);
+        if (new_page == NULL)
+        {
+            return NULL;
+        }
+        new_page->next_page = _pool->pages;
+        new_page->size = _pool->page_size;
+        _pool->pages = new_page;
+
+        _pool->bump = (char*)new_page + C_HASH_MULTIMAP_PAGE_HEADER;
+        _pool->bump_end = (char*)new_page + _pool->page_size;
+    }
+
+    void *const object = _pool->bump;
+    _pool->bump += _pool->object_size;
+    return object;
+}
+
+// Гарантирует, что следующие _count объектов будут выданы пулом без обращения к распределителю.
+// Если в последней странице места недостаточно, одним блоком выделяется страница, вмещающая
+// все объекты, остаток прежней страницы при этом не используется до очистки пула.
+// Объекты из списка свободных не учитываются.
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t pool_reserve(const c_hash_multimap *const _hash_multimap,
+                              c_hash_multimap_pool *const _pool,
+                              const size_t _count)
+{
+    if ((size_t)(_pool->bump_end - _pool->bump) / _pool->object_size >= _count)
+    {
+        return 1;
+    }
+
+    // Контроль переполнения.
+    if (_count > (SIZE_MAX - C_HASH_MULTIMAP_PAGE_HEADER) / _pool->object_size)
+    {
+        return -1;
+    }
+    size_t page_size = C_HASH_MULTIMAP_PAGE_HEADER + _count * _pool->object_size;
+    if (page_size < _pool->page_size)
+    {
+        page_size = _pool->page_size;
+    }
+
+    c_hash_multimap_page *const new_page = memory_alloc(_hash_multimap, page_size);
+    if (new_page == NULL)
+    {
+        return -2;
+    }
+    new_page->next_page = _pool->pages;
+    new_page->size = page_size;
+    _pool->pages = new_page;
+
+    _pool->bump = (char*)new_page + C_HASH_MULTIMAP_PAGE_HEADER;
+    _pool->bump_end = (char*)new_page + page_size;
+
+    return 1;
+}
+
+// Возвращает объект в пул.
+static void pool_free(c_hash_multimap_pool *const _pool,
+                      void *const _object)
+{
+    *(void**)_object = _pool->free_list;
+    _pool->free_list = _object;
+}
+
+// Возвращает распределителю все страницы пула.
+// Все выданные пулом объекты становятся недействительными.
+static void pool_release(const c_hash_multimap *const _hash_multimap,
+                         c_hash_multimap_pool *const _pool)
+{
+    c_hash_multimap_page *select_page = _pool->pages,
+                         *delete_page;
+    while (select_page != NULL)
+    {
+        delete_page = select_page;
+        select_page = select_page->next_page;
+        memory_free(_hash_multimap, delete_page, delete_page->size);
+    }
+
+    _pool->pages = NULL;
+    _pool->free_list = NULL;
+    _pool->bump = NULL;
+    _pool->bump_end = NULL;
+}
+
+// Индекс младшего установленного бита, маска не должна быть нулевой.
+static inline size_t bit_lowest(const uint64_t _mask)
+{
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctzll(_mask);
+#else
+    size_t index = 0;
+    uint64_t mask = _mask;
+    while ((mask & 1) == 0)
+    {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Операции над группой управляющих байтов открытой адресации.
+// Каждая операция возвращает маску, в которой подходящим байтам группы соответствуют
+// установленные биты. Индекс байта в группе равен bit_lowest(маска) >> C_HASH_MULTIMAP_LANE_SHIFT.
+#if defined(C_HASH_MULTIMAP_AVX2)
+
+#define C_HASH_MULTIMAP_LANE_SHIFT 0
+
+// Байты, хранящие заданную метку.
+static inline uint64_t group_match(const uint8_t *const _group,
+                                   const uint8_t _tag)
+{
+    const __m256i ctrl = _mm256_loadu_si256((const __m256i*)_group);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8((char)_tag)));
+}
+
+// Пустые байты.
+static inline uint64_t group_match_empty(const uint8_t *const _group)
+{
+    const __m256i ctrl = _mm256_loadu_si256((const __m256i*)_group);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl,
+                                                             _mm256_set1_epi8((char)C_HASH_MULTIMAP_CTRL_EMPTY)));
+}
+
+// Пустые байты и надгробия.
+static inline uint64_t group_match_free(const uint8_t *const _group)
+{
+    const __m256i ctrl = _mm256_loadu_si256((const __m256i*)_group);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-1), ctrl));
+}
+
+#elif defined(C_HASH_MULTIMAP_SSE2)
+
+#define C_HASH_MULTIMAP_LANE_SHIFT 0
+
+// Байты, хранящие заданную метку.
+static inline uint64_t group_match(const uint8_t *const _group,
+                                   const uint8_t _tag)
+{
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)_group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)_tag)));
+}
+
+// Пустые байты.
+static inline uint64_t group_match_empty(const uint8_t *const _group)
+{
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)_group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl,
+                                                       _mm_set1_epi8((char)C_HASH_MULTIMAP_CTRL_EMPTY)));
+}
+
+// Пустые байты и надгробия.
+static inline uint64_t group_match_free(const uint8_t *const _group)
+{
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)_group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+}
+
+#else
+
+#define C_HASH_MULTIMAP_LANE_SHIFT 3
+
+#define C_HASH_MULTIMAP_LSB ( (uint64_t) 0x0101010101010101u )
+#define C_HASH_MULTIMAP_MSB ( (uint64_t) 0x8080808080808080u )
+
+// Загружает группу в слово так, что i-й байт группы становится i-м байтом слова
+// независимо от порядка байтов платформы.
+static inline uint64_t group_load(const uint8_t *const _group)
+{
+    uint64_t word = 0;
+    for (size_t i = 0; i < C_HASH_MULTIMAP_GROUP; ++i)
+    {
+        word |= (uint64_t)_group[i] << (i * 8);
+    }
+    return word;
+}
+
+// Байты, хранящие заданную метку.
+// Допускает ложные совпадения, поэтому найденный слот необходимо проверять полностью.
+static inline uint64_t group_match(const uint8_t *const _group,
+                                   const uint8_t _tag)
+{
+    const uint64_t word = group_load(_group) ^ (C_HASH_MULTIMAP_LSB * _tag);
+    return (word - C_HASH_MULTIMAP_LSB) & ~word & C_HASH_MULTIMAP_MSB;
+}
+
+// Пустые байты.
+static inline uint64_t group_match_empty(const uint8_t *const _group)
+{
+    const uint64_t word = group_load(_group);
+    return word & ~(word << 6) & C_HASH_MULTIMAP_MSB;
+}
+
+// Пустые байты и надгробия.
+static inline uint64_t group_match_free(const uint8_t *const _group)
+{
+    const uint64_t word = group_load(_group);
+    return word & ~(word << 7) & C_HASH_MULTIMAP_MSB;
+}
+
+#endif
+
+// Метка хэша, хранимая в управляющем байте занятого слота открытой адресации.
+#define C_HASH_MULTIMAP_TAG(_k_hash) ( (uint8_t)((_k_hash) & 0x7F) )
+
+// Группа, с которой начинается последовательность проб хэша.
+#define C_HASH_MULTIMAP_GROUP_FIRST(_k_hash, _groups_mask) ( ((_k_hash) >> 7) & (_groups_mask) )
+
+// Количество цепочек, которое может храниться в таблице открытой адресации с заданным количеством слотов.
+static size_t open_limit(const c_hash_multimap *const _hash_multimap,
+                         const size_t _slots_count)
+{
+    float max_load_factor = _hash_multimap->max_load_factor;
+    if (max_load_factor > C_HASH_MULTIMAP_OPEN_MLF)
+    {
+        max_load_factor = C_HASH_MULTIMAP_OPEN_MLF;
+    }
+    return (size_t)((double)_slots_count * max_load_factor);
+}
+
+// Возвращает индекс первого пустого слота или надгробия в последовательности проб хэша.
+// Последовательность проб обходит группы с треугольным шагом, что при количестве групп,
+// являющемся степенью двойки, гарантирует посещение каждой группы.
+static size_t open_free(const uint8_t *const _ctrl,
+                        const size_t _slots_count,
+                        const size_t _k_hash)
+{
+    const size_t groups_mask = _slots_count / C_HASH_MULTIMAP_GROUP - 1;
+    size_t group = C_HASH_MULTIMAP_GROUP_FIRST(_k_hash, groups_mask);
+    for (size_t step = 1; ; ++step)
+    {
+        const uint64_t free_mask = group_match_free(_ctrl + group * C_HASH_MULTIMAP_GROUP);
+        if (free_mask != 0)
+        {
+            return group * C_HASH_MULTIMAP_GROUP + (bit_lowest(free_mask) >> C_HASH_MULTIMAP_LANE_SHIFT);
+        }
+        group = (group + step) & groups_mask;
+    }
+}
+
+// Приводит заданное количество слотов к допустимому для механизма хранения.
+// В случае переполнения возвращает 0.
+static size_t slots_round(const c_hash_multimap *const _hash_multimap,
+                          const size_t _slots_count)
+{
+    if (_slots_count == 0)
+    {
+        return 0;
+    }
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        if (_slots_count < C_HASH_MULTIMAP_GROUP)
+        {
+            return C_HASH_MULTIMAP_GROUP;
+        }
+        return pow2_round(_slots_count);
+    }
+    // При одновременном доступе слотов не может быть меньше, чем полос.
+    if (_slots_count < _hash_multimap->stripes_count)
+    {
+        return _hash_multimap->stripes_count;
+    }
+    if (_hash_multimap->pow2_slots != 0)
+    {
+        return pow2_round(_slots_count);
+    }
+    return _slots_count;
+}
+
+// Количество битов в слове битовой карты занятости слотов.
+#define C_HASH_MULTIMAP_OCCUPIED_BITS ( (size_t) 64 )
+
+// Смещение битовой карты занятости от начала слотов, занимающих заданное количество указателей,
+// выровненное на размер слова карты.
+#define C_HASH_MULTIMAP_OCCUPIED_OFFSET(_pointers_count)\
+    ( ((_pointers_count) * sizeof(c_hash_multimap_chain*) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1) )
+
+// Размер памяти заданного количества слотов вместе с битовой картой их занятости, которая располагается
+// сразу за слотами.
+// В случае переполнения возвращает 0.
+static size_t slots_size(const c_hash_multimap *const _hash_multimap,
+                         const size_t _slots_count)
+{
+    // Ограничение указателей половиной адресного пространства оставляет запас на битовую карту
+    // и выравнивание корзин.
+    const size_t pointers_count = _slots_count << _hash_multimap->slot_shift;
+    if ( ((pointers_count >> _hash_multimap->slot_shift) != _slots_count) ||
+         (pointers_count > (SIZE_MAX - C_HASH_MULTIMAP_CACHE_LINE) / sizeof(c_hash_multimap_chain*) / 2) )
+    {
+        return 0;
+    }
+
+    return C_HASH_MULTIMAP_OCCUPIED_OFFSET(pointers_count) +
+           (_slots_count / C_HASH_MULTIMAP_OCCUPIED_BITS + (_slots_count % C_HASH_MULTIMAP_OCCUPIED_BITS != 0)) *
+           sizeof(uint64_t);
+}
+
+// Выделяет память под заданное ненулевое количество пустых слотов.
+// Для открытой адресации дополнительно выделяются управляющие байты.
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t slots_alloc(const c_hash_multimap *const _hash_multimap,
+                             const size_t _slots_count,
+                             c_hash_multimap_chain ***const _slots,
+                             uint8_t **const _ctrl)
+{
+    const size_t new_slots_size = slots_size(_hash_multimap, _slots_count);
+    if (new_slots_size == 0)
+    {
+        return -1;
+    }
+
+    // Корзины выравниваются на строку кэша. Смещение корзин от начала выделенной памяти
+    // (от 1 до размера строки) хранится в байте перед ними.
+    const size_t align = (_hash_multimap->slot_shift != 0) ? C_HASH_MULTIMAP_CACHE_LINE : 0;
+
+    heap_lock(_hash_multimap);
+    unsigned char *const new_memory = memory_alloc(_hash_multimap, new_slots_size + align);
+    heap_unlock(_hash_multimap);
+    if (new_memory == NULL)
+    {
+        return -2;
+    }
+    c_hash_multimap_chain **new_slots = (c_hash_multimap_chain**)new_memory;
+    if (align != 0)
+    {
+        const size_t pad = align - (uintptr_t)new_memory % align;
+        new_memory[pad - 1] = (unsigned char)pad;
+        new_slots = (c_hash_multimap_chain**)(new_memory + pad);
+    }
+    memset(new_slots, 0, new_slots_size);
+
+    uint8_t *new_ctrl = NULL;
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        new_ctrl = memory_alloc(_hash_multimap, _slots_count);
+        if (new_ctrl == NULL)
+        {
+            memory_free(_hash_multimap, new_slots, new_slots_size);
+            return -2;
+        }
+        memset(new_ctrl, C_HASH_MULTIMAP_CTRL_EMPTY, _slots_count);
+    }
+
+    *_slots = new_slots;
+    *_ctrl = new_ctrl;
+
+    return 1;
+}
+
+// Освобождает память слотов.
+static void slots_free(const c_hash_multimap *const _hash_multimap,
+                       c_hash_multimap_chain **const _slots,
+                       uint8_t *const _ctrl,
+                       const size_t _slots_count)
+{
+    if (_slots == NULL)
+    {
+        return;
+    }
+
+    unsigned char *memory = (unsigned char*)_slots;
+    size_t size = slots_size(_hash_multimap, _slots_count);
+    if (_hash_multimap->slot_shift != 0)
+    {
+        memory -= memory[-1];
+        size += C_HASH_MULTIMAP_CACHE_LINE;
+    }
+
+    heap_lock(_hash_multimap);
+    memory_free(_hash_multimap, memory, size);
+    memory_free(_hash_multimap, _ctrl, _slots_count);
+    heap_unlock(_hash_multimap);
+}
+
+// Битовая карта занятости заданных слотов: бит слота установлен, если слот не равен NULL.
+// Обходы переходят по карте сразу к следующему непустому слоту, не просматривая пустые.
+static inline uint64_t *slots_occupied(const c_hash_multimap *const _hash_multimap,
+                                       c_hash_multimap_chain *const *const _slots,
+                                       const size_t _slots_count)
+{
+    const size_t pointers_count = _slots_count << _hash_multimap->slot_shift;
+    return (uint64_t*)((char*)_slots + C_HASH_MULTIMAP_OCCUPIED_OFFSET(pointers_count));
+}
+
+// Указатель на начало списка цепочек слота с заданным индексом.
+// Корзина начинается с указателя на первую цепочку своего списка, поэтому для всех механизмов
+// хранения список слота просматривается одинаково.
+static inline c_hash_multimap_chain **slot_list(const c_hash_multimap *const _hash_multimap,
+                                                c_hash_multimap_chain *const *const _slots,
+                                                const size_t _index)
+{
+    return (c_hash_multimap_chain**)_slots + (_index << _hash_multimap->slot_shift);
+}
+
+// Корзина с заданным индексом.
+static inline c_hash_multimap_bucket *slot_bucket(const c_hash_multimap *const _hash_multimap,
+                                                  c_hash_multimap_chain *const *const _slots,
+                                                  const size_t _index)
+{
+    return (c_hash_multimap_bucket*)slot_list(_hash_multimap, _slots, _index);
+}
+
+// Отмечает слот с заданным индексом занятым.
+static inline void slot_occupy(const c_hash_multimap *const _hash_multimap,
+                               uint64_t *const _occupied,
+                               const size_t _index)
+{
+    uint64_t *const word = &_occupied[_index / C_HASH_MULTIMAP_OCCUPIED_BITS];
+    const uint64_t bit = (uint64_t)1 << (_index % C_HASH_MULTIMAP_OCCUPIED_BITS);
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Соседние слоты принадлежат разным полосам, поэтому слово карты изменяется атомарно.
+    if (_hash_multimap->stripes_count != 0)
+    {
+        __atomic_fetch_or(word, bit, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    *word |= bit;
+}
+
+// Отмечает слот с заданным индексом пустым.
+static inline void slot_vacate(const c_hash_multimap *const _hash_multimap,
+                               uint64_t *const _occupied,
+                               const size_t _index)
+{
+    uint64_t *const word = &_occupied[_index / C_HASH_MULTIMAP_OCCUPIED_BITS];
+    const uint64_t bit = (uint64_t)1 << (_index % C_HASH_MULTIMAP_OCCUPIED_BITS);
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        __atomic_fetch_and(word, ~bit, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    *word &= ~bit;
+}
+
+// Индекс первого непустого слота в диапазоне [_index, _end).
+// Если непустых слотов в диапазоне нет, возвращает _end.
+static inline size_t slot_next(const uint64_t *const _occupied,
+                               const size_t _index,
+                               const size_t _end)
+{
+    if (_index >= _end)
+    {
+        return _end;
+    }
+
+    size_t word = _index / C_HASH_MULTIMAP_OCCUPIED_BITS;
+    const size_t words_end = (_end - 1) / C_HASH_MULTIMAP_OCCUPIED_BITS;
+    uint64_t mask = _occupied[word] & (~(uint64_t)0 << (_index % C_HASH_MULTIMAP_OCCUPIED_BITS));
+    while (mask == 0)
+    {
+        if (word == words_end)
+        {
+            return _end;
+        }
+        mask = _occupied[++word];
+    }
+
+    const size_t index = word * C_HASH_MULTIMAP_OCCUPIED_BITS + bit_lowest(mask);
+    return (index < _end) ? index : _end;
+}
+
+// Встраивает цепочку в начало списка корзины.
+// Читатели без блокировок просматривают список корзины с entries[0], поэтому остальные указатели
+// сдвигаются до того, как цепочка становится началом списка.
+static void bucket_push(c_hash_multimap_bucket *const _bucket,
+                        c_hash_multimap_chain *const _chain)
+{
+    C_HASH_MULTIMAP_STORE(_chain->next_chain, _bucket->entries[0]);
+
+    size_t e = _bucket->count;
+    if (e == C_HASH_MULTIMAP_BUCKET_ENTRIES)
+    {
+        // Последняя цепочка корзины становится началом продолжения списка.
+        _bucket->overflow = _bucket->entries[--e];
+    } else {
+        ++_bucket->count;
+    }
+    for (; e > 0; --e)
+    {
+        _bucket->entries[e] = _bucket->entries[e - 1];
+        _bucket->tags[e] = _bucket->tags[e - 1];
+    }
+
+    _bucket->tags[0] = C_HASH_MULTIMAP_BUCKET_TAG(_chain->k_hash);
+    C_HASH_MULTIMAP_STORE(_bucket->entries[0], _chain);
+}
+
+// Ампутирует цепочку из списка корзины, _prev_chain - предыдущая цепочка списка или NULL.
+// Место ампутированной цепочки в корзине занимают следующие, а последнее место - начало продолжения списка.
+// Если корзина опустела, возвращает > 0, иначе 0.
+static size_t bucket_remove(c_hash_multimap_bucket *const _bucket,
+                            c_hash_multimap_chain *const _chain,
+                            c_hash_multimap_chain *const _prev_chain)
+{
+    size_t e = 0;
+    while ( (e < _bucket->count) && (_bucket->entries[e] != _chain) )
+    {
+        ++e;
+    }
+
+    if (e == _bucket->count)
+    {
+        // Цепочка находится в продолжении списка.
+        C_HASH_MULTIMAP_STORE(_prev_chain->next_chain, _chain->next_chain);
+        if (_bucket->overflow == _chain)
+        {
+            _bucket->overflow = _chain->next_chain;
+        }
+        return 0;
+    }
+
+    if (e > 0)
+    {
+        C_HASH_MULTIMAP_STORE(_bucket->entries[e - 1]->next_chain, _chain->next_chain);
+    }
+    for (; e + 1 < _bucket->count; ++e)
+    {
+        C_HASH_MULTIMAP_STORE(_bucket->entries[e], _bucket->entries[e + 1]);
+        _bucket->tags[e] = _bucket->tags[e + 1];
+    }
+
+    c_hash_multimap_chain *const overflow = _bucket->overflow;
+    if (overflow != NULL)
+    {
+        _bucket->tags[e] = C_HASH_MULTIMAP_BUCKET_TAG(overflow->k_hash);
+        C_HASH_MULTIMAP_STORE(_bucket->entries[e], overflow);
+        _bucket->overflow = overflow->next_chain;
+        return 0;
+    }
+
+    C_HASH_MULTIMAP_STORE(_bucket->entries[e], NULL);
+    --_bucket->count;
+
+    return (_bucket->count == 0);
+}
+
+// Размер массива данных заданной вместимости без индекса, с хэшами данных или без них.
+#define C_HASH_MULTIMAP_VALUES_SIZE(_capacity, _hashed)\
+    ( sizeof(c_hash_multimap_values) + (_capacity) * ( sizeof(void*) + ( (_hashed) ? sizeof(size_t) : 0 ) ) )
+
+// Минимальная вместимость индексируемого массива данных: меньшие массивы выделяются из пулов.
+#define C_HASH_MULTIMAP_DATA_INDEX_MIN ( (size_t)1 << C_HASH_MULTIMAP_VALUES_CLASSES )
+
+// Проверяет, есть ли у массива данных заданной вместимости индекс.
+// Индекс располагается в том же блоке памяти после данных и их хэшей: это открытая адресация
+// с линейным пробированием на 2 * capacity мест, каждое из которых хранит позицию данных + 1
+// или 0, если место свободно.
+static inline size_t values_indexed(const c_hash_multimap *const _hash_multimap,
+                                    const size_t _capacity)
+{
+    return (_capacity >= _hash_multimap->data_index_capacity);
+}
+
+// Возвращает хэши данных массива, расположенные в том же блоке памяти сразу за данными.
+// Хэши есть у всех массивов, если задана функция генерации хэша по данным.
+static inline size_t *values_hashes(const c_hash_multimap_values *const _values)
+{
+    return (size_t*)(_values->datas + _values->capacity);
+}
+
+// Возвращает индекс массива данных.
+static inline size_t *values_index(const c_hash_multimap_values *const _values)
+{
+    return values_hashes(_values) + _values->capacity;
+}
+
+// Размер массива данных заданной вместимости вместе с хэшами данных и индексом.
+// В случае переполнения возвращает 0.
+static size_t values_size(const c_hash_multimap *const _hash_multimap,
+                          const size_t _capacity)
+{
+    size_t data_size = sizeof(void*);
+    if (_hash_multimap->hash_data != NULL)
+    {
+        data_size += sizeof(size_t);
+    }
+    if (values_indexed(_hash_multimap, _capacity) != 0)
+    {
+        data_size += 2 * sizeof(size_t);
+    }
+    if (_capacity > (SIZE_MAX - sizeof(c_hash_multimap_values)) / data_size)
+    {
+        return 0;
+    }
+    return sizeof(c_hash_multimap_values) + _capacity * data_size;
+}
+
+// Вычисляет хэш данных.
+// Хэш дополнительно перемешивается: место в индексе выбирается по младшим битам.
+static inline size_t data_hash(const c_hash_multimap *const _hash_multimap,
+                               const void *const _data)
+{
+    return hash_mix(_hash_multimap->hash_data(_data));
+}
+
+// Записывает данные и их хэш на заданную позицию массива.
+static inline void values_set(const c_hash_multimap *const _hash_multimap,
+                              c_hash_multimap_values *const _values,
+                              const size_t _position,
+                              const void *const _data)
+{
+    _values->datas[_position] = (void*)_data;
+    if (_hash_multimap->hash_data != NULL)
+    {
+        values_hashes(_values)[_position] = data_hash(_hash_multimap, _data);
+    }
+}
+
+// Переносит данные и их хэш с позиции _from массива на позицию _to.
+static inline void values_copy(const c_hash_multimap *const _hash_multimap,
+                               c_hash_multimap_values *const _values,
+                               const size_t _to,
+                               const size_t _from)
+{
+    _values->datas[_to] = _values->datas[_from];
+    if (_hash_multimap->hash_data != NULL)
+    {
+        values_hashes(_values)[_to] = values_hashes(_values)[_from];
+    }
+}
+
+// Копирует в пустой массив все данные другого массива вместе с их хэшами.
+// Индекс не копируется.
+static void values_assign(const c_hash_multimap *const _hash_multimap,
+                          c_hash_multimap_values *const _values,
+                          const c_hash_multimap_values *const _source)
+{
+    memcpy(_values->datas, _source->datas, _source->count * sizeof(void*));
+    if (_hash_multimap->hash_data != NULL)
+    {
+        memcpy(values_hashes(_values), values_hashes(_source), _source->count * sizeof(size_t));
+    }
+    _values->count = _source->count;
+}
+
+// Добавляет в индекс массива данных позицию уже записанных в массив данных.
+// Читатели без блокировок видят позицию только после записи данных.
+static void values_index_insert(c_hash_multimap_values *const _values,
+                                const size_t _position)
+{
+    size_t *const index = values_index(_values);
+    const size_t mask = 2 * _values->capacity - 1;
+
+    size_t s = values_hashes(_values)[_position] & mask;
+    while (index[s] != 0)
+    {
+        s = (s + 1) & mask;
+    }
+    C_HASH_MULTIMAP_STORE(index[s], _position + 1);
+}
+
+// Заново строит индекс массива данных, если он должен его иметь.
+// Массив не должны просматривать читатели без блокировок.
+static void values_index_build(const c_hash_multimap *const _hash_multimap,
+                               c_hash_multimap_values *const _values)
+{
+    if (values_indexed(_hash_multimap, _values->capacity) == 0)
+    {
+        return;
+    }
+
+    memset(values_index(_values), 0, 2 * _values->capacity * sizeof(size_t));
+    for (size_t v = 0; v < _values->count; ++v)
+    {
+        values_index_insert(_values, v);
+    }
+}
+
+// Возвращает место индекса, которое хранит заданную позицию.
+static size_t values_index_place(const c_hash_multimap_values *const _values,
+                                 const size_t _position)
+{
+    const size_t *const index = values_index(_values);
+    const size_t mask = 2 * _values->capacity - 1;
+
+    size_t s = values_hashes(_values)[_position] & mask;
+    while (index[s] != _position + 1)
+    {
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+// Удаляет из индекса массива данных позицию _position, а позицию последних данных заменяет на нее.
+// Вызывается до того, как последние данные займут место удаляемых.
+// Массив не должны просматривать читатели без блокировок.
+static void values_index_remove(c_hash_multimap_values *const _values,
+                                const size_t _position)
+{
+    size_t *const index = values_index(_values);
+    const size_t *const hashes = values_hashes(_values);
+    const size_t mask = 2 * _values->capacity - 1;
+    const size_t last = _values->count - 1;
+
+    // Освобожденное место занимают следующие места кластера, если их начальное место
+    // находится не дальше освобожденного, поэтому надгробия не нужны.
+    size_t hole = values_index_place(_values, _position);
+    for (size_t next = (hole + 1) & mask; index[next] != 0; next = (next + 1) & mask)
+    {
+        const size_t home = hashes[index[next] - 1] & mask;
+        if ( ( (next - home) & mask ) >= ( (next - hole) & mask ) )
+        {
+            index[hole] = index[next];
+            hole = next;
+        }
+    }
+    index[hole] = 0;
+
+    if (_position != last)
+    {
+        index[values_index_place(_values, last)] = _position + 1;
+    }
+}
+
+// Сравнивает данные функцией сравнения данных.
+// Если данные идентичны, возвращает > 0, иначе возвращает 0.
+static inline size_t data_equal(const c_hash_multimap *const _hash_multimap,
+                                const void *const _data_a,
+                                const void *const _data_b)
+{
+    C_HASH_MULTIMAP_COUNT(_hash_multimap, data_comparisons, 1);
+    return (_hash_multimap->comp_data(_data_a, _data_b) > 0);
+}
+
+// Ищет заданные данные среди первых _count данных массива: по индексу, если он есть, иначе перебором.
+// Если хэши данных есть, функция сравнения вызывается только для данных с таким же хэшем.
+// Если _all == 0, поиск завершается на первом совпадении.
+// Возвращает количество совпадений, а если они есть и _position != NULL, помещает в заданное
+// расположение позицию первого из них.
+static size_t values_find(const c_hash_multimap *const _hash_multimap,
+                          const c_hash_multimap_values *const _values,
+                          const size_t _count,
+                          const void *const _data,
+                          const size_t _all,
+                          size_t *const _position)
+{
+    size_t found = 0;
+
+    if (_hash_multimap->hash_data == NULL)
+    {
+        for (size_t v = 0; v < _count; ++v)
+        {
+            if (data_equal(_hash_multimap, _values->datas[v], _data) > 0)
+            {
+                if ( (found == 0) && (_position != NULL) )
+                {
+                    *_position = v;
+                }
+                ++found;
+                if (_all == 0)
+                {
+                    break;
+                }
+            }
+        }
+        return found;
+    }
+
+    const size_t d_hash = data_hash(_hash_multimap, _data);
+    const size_t *const hashes = values_hashes(_values);
+
+    if (values_indexed(_hash_multimap, _values->capacity) != 0)
+    {
+        const size_t *const index = values_index(_values);
+        const size_t mask = 2 * _values->capacity - 1;
+        for (size_t s = d_hash & mask; ; s = (s + 1) & mask)
+        {
+            const size_t entry = C_HASH_MULTIMAP_LOAD(index[s]);
+            if (entry == 0)
+            {
+                break;
+            }
+            // Позиции данных, добавленных после чтения их количества, пропускаются.
+            if ( (entry <= _count) &&
+                 (hashes[entry - 1] == d_hash) &&
+                 (data_equal(_hash_multimap, _values->datas[entry - 1], _data) > 0) )
+            {
+                if ( (found == 0) && (_position != NULL) )
+                {
+                    *_position = entry - 1;
+                }
+                ++found;
+                if (_all == 0)
+                {
+                    break;
+                }
+            }
+        }
+    } else {
+        for (size_t v = 0; v < _count; ++v)
+        {
+            if ( (hashes[v] == d_hash) &&
+                 (data_equal(_hash_multimap, _values->datas[v], _data) > 0) )
+            {
+                if ( (found == 0) && (_position != NULL) )
+                {
+                    *_position = v;
+                }
+                ++found;
+                if (_all == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+// Выделяет пустой массив данных заданной вместимости, которая должна быть степенью двойки.
+// В случае ошибки возвращает NULL.
+static c_hash_multimap_values *values_alloc(c_hash_multimap *const _hash_multimap,
+                                            const size_t _capacity)
+{
+    c_hash_multimap_values *new_values = NULL;
+
+    const size_t values_class = bit_lowest(_capacity);
+    heap_lock(_hash_multimap);
+    if (values_class < C_HASH_MULTIMAP_VALUES_CLASSES)
+    {
+        new_values = pool_alloc(_hash_multimap, &_hash_multimap->values_pools[values_class]);
+    } else {
+        // Контроль переполнения.
+        const size_t values_bytes = values_size(_hash_multimap, _capacity);
+        if (values_bytes != 0)
+        {
+            new_values = memory_alloc(_hash_multimap, values_bytes);
+            if (new_values != NULL)
+            {
+                ++_hash_multimap->values_large;
+            }
+        }
+    }
+    heap_unlock(_hash_multimap);
+
+    if (new_values != NULL)
+    {
+        new_values->count = 0;
+        new_values->capacity = _capacity;
+    }
+
+    return new_values;
+}
+
+// Освобождает массив данных.
+static void values_free(c_hash_multimap *const _hash_multimap,
+                        c_hash_multimap_values *const _values)
+{
+    const size_t values_class = bit_lowest(_values->capacity);
+    heap_lock(_hash_multimap);
+    if (values_class < C_HASH_MULTIMAP_VALUES_CLASSES)
+    {
+        pool_free(&_hash_multimap->values_pools[values_class], _values);
+    } else {
+        memory_free(_hash_multimap, _values, values_size(_hash_multimap, _values->capacity));
+        --_hash_multimap->values_large;
+    }
+    heap_unlock(_hash_multimap);
+}
+
+// Возвращает в пулы цепочку вместе с ее массивом данных.
+static void chain_free(c_hash_multimap *const _hash_multimap,
+                       c_hash_multimap_chain *const _chain)
+{
+    values_free(_hash_multimap, _chain->values);
+
+    heap_lock(_hash_multimap);
+    pool_free(&_hash_multimap->chains_pool, _chain);
+    heap_unlock(_hash_multimap);
+}
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+
+// Размер записи читателя: каждая запись занимает целое число строк кэша, чтобы объявления эпох
+// разных потоков не попадали в одну строку.
+#define C_HASH_MULTIMAP_READER_SIZE\
+    ( (sizeof(c_hash_multimap_reader) + C_HASH_MULTIMAP_CACHE_LINE - 1) /\
+      C_HASH_MULTIMAP_CACHE_LINE * C_HASH_MULTIMAP_CACHE_LINE )
+
+// Количество созданных хэш-мультиотображений с чтением без блокировок, из него выдаются идентификаторы.
+static size_t maps_count = 0;
+
+// Последняя запись читателя, найденная потоком, и идентификатор ее хэш-мультиотображения.
+static __thread size_t reader_cache_id = 0;
+static __thread c_hash_multimap_reader *reader_cache = NULL;
+
+// Возвращает запись читателя текущего потока, при первом чтении потока создает ее.
+// В случае нехватки памяти возвращает NULL.
+static c_hash_multimap_reader *reader_get(const c_hash_multimap *const _hash_multimap)
+{
+    if (reader_cache_id == _hash_multimap->id)
+    {
+        return reader_cache;
+    }
+
+    // Записи не удаляются до удаления хэш-мультиотображения, а их связи не изменяются после публикации,
+    // поэтому список просматривается без блокировки.
+    const pthread_t self = pthread_self();
+    c_hash_multimap_reader *select_reader = C_HASH_MULTIMAP_LOAD(_hash_multimap->readers);
+    while ( (select_reader != NULL) && (pthread_equal(select_reader->owner, self) == 0) )
+    {
+        select_reader = select_reader->next_reader;
+    }
+
+    if (select_reader == NULL)
+    {
+        c_hash_multimap *const hash_multimap = (c_hash_multimap*)_hash_multimap;
+
+        heap_lock(hash_multimap);
+        select_reader = memory_alloc(hash_multimap, C_HASH_MULTIMAP_READER_SIZE);
+        if (select_reader != NULL)
+        {
+            select_reader->epoch = 0;
+            select_reader->depth = 0;
+            select_reader->owner = self;
+            select_reader->next_reader = hash_multimap->readers;
+            C_HASH_MULTIMAP_STORE(hash_multimap->readers, select_reader);
+        }
+        heap_unlock(hash_multimap);
+
+        if (select_reader == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    reader_cache_id = _hash_multimap->id;
+    reader_cache = select_reader;
+
+    return select_reader;
+}
+
+// Начинает чтение без блокировок: объявляет текущую глобальную эпоху.
+static inline void reader_enter(const c_hash_multimap *const _hash_multimap,
+                                c_hash_multimap_reader *const _reader)
+{
+    if (_reader->depth++ == 0)
+    {
+        const size_t epoch = __atomic_load_n(&_hash_multimap->epoch, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&_reader->epoch, (epoch << 1) | 1, __ATOMIC_RELEASE);
+        // Объявление должно стать видно писателям раньше, чем читатель обратится к слотам.
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+// Завершает чтение без блокировок.
+static inline void reader_exit(c_hash_multimap_reader *const _reader)
+{
+    if (--_reader->depth == 0)
+    {
+        __atomic_store_n(&_reader->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// Продвигает глобальную эпоху, если все читающие потоки объявили текущую.
+// Вызывающий должен удерживать блокировку пулов.
+static void epoch_advance(c_hash_multimap *const _hash_multimap)
+{
+    const size_t epoch = _hash_multimap->epoch;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (const c_hash_multimap_reader *select_reader = _hash_multimap->readers;
+         select_reader != NULL;
+         select_reader = select_reader->next_reader)
+    {
+        const size_t reader_epoch = __atomic_load_n(&select_reader->epoch, __ATOMIC_ACQUIRE);
+        if ( ((reader_epoch & 1) != 0) && ((reader_epoch >> 1) != epoch) )
+        {
+            return;
+        }
+    }
+
+    __atomic_store_n(&_hash_multimap->epoch, epoch + 1, __ATOMIC_RELEASE);
+}
+
+// Дожидается завершения всех чтений без блокировок, начатых до вызова.
+// Вызывающий не должен удерживать блокировку пулов.
+static void readers_wait(c_hash_multimap *const _hash_multimap)
+{
+    heap_lock(_hash_multimap);
+    const size_t epoch = _hash_multimap->epoch + 1;
+    __atomic_store_n(&_hash_multimap->epoch, epoch, __ATOMIC_RELEASE);
+    const c_hash_multimap_reader *select_reader = _hash_multimap->readers;
+    heap_unlock(_hash_multimap);
+
+    // Потоки, начавшие чтение после продвижения эпохи, ампутированных объектов уже не увидят.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (; select_reader != NULL; select_reader = select_reader->next_reader)
+    {
+        for (;;)
+        {
+            const size_t reader_epoch = __atomic_load_n(&select_reader->epoch, __ATOMIC_ACQUIRE);
+            if ( ((reader_epoch & 1) == 0) || ((reader_epoch >> 1) >= epoch) )
+            {
+                break;
+            }
+            sched_yield();
+        }
+    }
+}
+
+// Освобождает ампутированный объект, вызывая для него заданные функции удаления.
+static void retired_release(c_hash_multimap *const _hash_multimap,
+                            const size_t _kind,
+                            void *const _object,
+                            void (*const _del_key)(void *const _key),
+                            void (*const _del_data)(void *const _data))
+{
+    if (_kind == C_HASH_MULTIMAP_RETIRED_CHAIN)
+    {
+        c_hash_multimap_chain *const chain = _object;
+        if (_del_data != NULL)
+        {
+            for (size_t v = 0; v < chain->values->count; ++v)
+            {
+                _del_data(chain->values->datas[v]);
+            }
+        }
+        if ( (_del_key != NULL) && (_hash_multimap->key_size == 0) )
+        {
+            _del_key(chain->key);
+        }
+        chain_free(_hash_multimap, chain);
+    } else if (_kind == C_HASH_MULTIMAP_RETIRED_VALUES)
+    {
+        values_free(_hash_multimap, _object);
+    } else if (_kind == C_HASH_MULTIMAP_RETIRED_DATA)
+    {
+        _del_data(_object);
+    } else {
+        c_hash_multimap_table *const table = _object;
+        slots_free(_hash_multimap, table->slots, NULL, table->slots_count);
+
+        heap_lock(_hash_multimap);
+        memory_free(_hash_multimap, table, sizeof(c_hash_multimap_table));
+        heap_unlock(_hash_multimap);
+    }
+}
+
+// Освобождает список ампутированных объектов вместе с его записями.
+static void retired_free(c_hash_multimap *const _hash_multimap,
+                         c_hash_multimap_retired *const _retired)
+{
+    if (_retired == NULL)
+    {
+        return;
+    }
+
+    c_hash_multimap_retired *select_retired = _retired;
+    while (select_retired != NULL)
+    {
+        retired_release(_hash_multimap, select_retired->kind, select_retired->object,
+                        select_retired->del_key, select_retired->del_data);
+        select_retired = select_retired->next_retired;
+    }
+
+    heap_lock(_hash_multimap);
+    select_retired = _retired;
+    while (select_retired != NULL)
+    {
+        c_hash_multimap_retired *const delete_retired = select_retired;
+        select_retired = select_retired->next_retired;
+        pool_free(&_hash_multimap->retired_pool, delete_retired);
+    }
+    heap_unlock(_hash_multimap);
+}
+
+// Откладывает освобождение ампутированного объекта, пока его могут просматривать читатели
+// без блокировок, и освобождает объекты, которые уже не просматривает ни один читатель.
+// Объект, ампутированный в эпоху e, освобождается, когда глобальная эпоха достигает e + 2:
+// к этому моменту все читатели, объявившие e или более раннюю эпоху, завершили чтение.
+static void retired_push(c_hash_multimap *const _hash_multimap,
+                         const size_t _kind,
+                         void *const _object,
+                         void (*const _del_key)(void *const _key),
+                         void (*const _del_data)(void *const _data))
+{
+    c_hash_multimap_retired *ready_retired = NULL;
+
+    heap_lock(_hash_multimap);
+    c_hash_multimap_retired *const new_retired = pool_alloc(_hash_multimap, &_hash_multimap->retired_pool);
+    if (new_retired != NULL)
+    {
+        new_retired->epoch = _hash_multimap->epoch;
+        new_retired->kind = _kind;
+        new_retired->object = _object;
+        new_retired->del_key = _del_key;
+        new_retired->del_data = _del_data;
+        new_retired->next_retired = _hash_multimap->retired;
+        _hash_multimap->retired = new_retired;
+
+        if (++_hash_multimap->retired_count >= C_HASH_MULTIMAP_RETIRED_BATCH)
+        {
+            epoch_advance(_hash_multimap);
+
+            // Эпохи объектов не возрастают от новых к старым, поэтому освобождаемые объекты
+            // составляют хвост списка.
+            c_hash_multimap_retired **link = &_hash_multimap->retired;
+            while ( (*link != NULL) && ((*link)->epoch + 2 > _hash_multimap->epoch) )
+            {
+                link = &(*link)->next_retired;
+            }
+            ready_retired = *link;
+            *link = NULL;
+            for (const c_hash_multimap_retired *select_retired = ready_retired;
+                 select_retired != NULL;
+                 select_retired = select_retired->next_retired)
+            {
+                --_hash_multimap->retired_count;
+            }
+        }
+    }
+    heap_unlock(_hash_multimap);
+
+    if (new_retired == NULL)
+    {
+        // Если памяти под запись нет, дожидаемся завершения чтений и освобождаем объект сразу.
+        readers_wait(_hash_multimap);
+        retired_release(_hash_multimap, _kind, _object, _del_key, _del_data);
+        return;
+    }
+
+    retired_free(_hash_multimap, ready_retired);
+}
+
+// Освобождает все ампутированные объекты.
+// Чтений без блокировок, начатых до их ампутации, быть не должно.
+static void retired_drain(c_hash_multimap *const _hash_multimap)
+{
+    heap_lock(_hash_multimap);
+    c_hash_multimap_retired *const ready_retired = _hash_multimap->retired;
+    _hash_multimap->retired = NULL;
+    _hash_multimap->retired_count = 0;
+    heap_unlock(_hash_multimap);
+
+    retired_free(_hash_multimap, ready_retired);
+}
+
+// Публикует для читателей без блокировок текущие слоты в заданном описании (NULL, если слотов нет)
+// и откладывает освобождение прежнего описания вместе с его слотами.
+static void table_publish(c_hash_multimap *const _hash_multimap,
+                          c_hash_multimap_table *const _table)
+{
+    if (_table != NULL)
+    {
+        _table->slots = _hash_multimap->slots;
+        _table->slots_count = _hash_multimap->slots_count;
+    }
+
+    c_hash_multimap_table *const old_table = _hash_multimap->table;
+    C_HASH_MULTIMAP_STORE(_hash_multimap->table, _table);
+
+    if (old_table != NULL)
+    {
+        retired_push(_hash_multimap, C_HASH_MULTIMAP_RETIRED_TABLE, old_table, NULL, NULL);
+    }
+}
+
+#endif
+
+// Освобождает массив данных, замененный другим.
+// Если массив могут просматривать читатели без блокировок, освобождение откладывается.
+static void values_release(c_hash_multimap *const _hash_multimap,
+                           c_hash_multimap_values *const _values)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        retired_push(_hash_multimap, C_HASH_MULTIMAP_RETIRED_VALUES, _values, NULL, NULL);
+        return;
+    }
+#endif
+    values_free(_hash_multimap, _values);
+}
+
+// Вызывает функцию удаления для данных, удаленных из хэш-мультиотображения.
+// Если данные могут просматривать читатели без блокировок, вызов откладывается.
+static void data_release(c_hash_multimap *const _hash_multimap,
+                         void *const _data,
+                         void (*const _del_data)(void *const _data))
+{
+    if (_del_data == NULL)
+    {
+        return;
+    }
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        retired_push(_hash_multimap, C_HASH_MULTIMAP_RETIRED_DATA, _data, NULL, _del_data);
+        return;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+    _del_data(_data);
+}
+
+// Задает параллельный обход хэш-мультиотображения без действий и функций удаления.
+static void job_init(c_hash_multimap_job *const _job,
+                     c_hash_multimap *const _hash_multimap,
+                     void *const _context,
+                     const c_hash_multimap_executor *const _executor)
+{
+    _job->hash_multimap = _hash_multimap;
+    _job->executor = _executor;
+
+    _job->slots_ranges = 0;
+    _job->ranges_count = 0;
+    _job->range_next = 0;
+
+    _job->action_key = NULL;
+    _job->action_data = NULL;
+    _job->del_key = NULL;
+    _job->del_data = NULL;
+    _job->context = _context;
+
+    _job->values_freed = 0;
+
+    _job->new_slots = NULL;
+    _job->new_slots_count = 0;
+}
+
+// Обрабатывает диапазоны слотов, пока незанятые диапазоны не кончатся.
+// Вызывается каждым исполнителем параллельного обхода со своим номером.
+static void job_task(void *const _job,
+                     const size_t _worker)
+{
+    c_hash_multimap_job *const job = _job;
+    c_hash_multimap *const hash_multimap = job->hash_multimap;
+
+    const size_t traverse = (job->action_key != NULL) || (job->action_data != NULL);
+    size_t values_freed = 0;
+
+    for (;;)
+    {
+#if defined(C_HASH_MULTIMAP_THREADS)
+        const size_t range = __atomic_fetch_add(&job->range_next, 1, __ATOMIC_RELAXED);
+#else
+        const size_t range = job->range_next++;
+#endif
+        if (range >= job->ranges_count)
+        {
+            break;
+        }
+
+        // Диапазоны старых слотов постепенного перестроения следуют за диапазонами текущих.
+        c_hash_multimap_chain *const *const slots = (range < job->slots_ranges) ? hash_multimap->slots :
+                                                                                  hash_multimap->rehash_slots;
+        const size_t slots_count = (range < job->slots_ranges) ? hash_multimap->slots_count :
+                                                                 hash_multimap->rehash_slots_count;
+        const size_t begin = ( (range < job->slots_ranges) ? range : range - job->slots_ranges ) *
+                             C_HASH_MULTIMAP_PARALLEL_RANGE;
+        const size_t end = (slots_count - begin < C_HASH_MULTIMAP_PARALLEL_RANGE) ? slots_count :
+                                                                                   begin + C_HASH_MULTIMAP_PARALLEL_RANGE;
+        const uint64_t *const occupied = slots_occupied(hash_multimap, slots, slots_count);
+
+        for (size_t s = slot_next(occupied, begin, end); s < end; s = slot_next(occupied, s + 1, end))
+        {
+            const c_hash_multimap_chain *select_chain = *slot_list(hash_multimap, slots, s);
+            while (select_chain != NULL)
+            {
+                c_hash_multimap_values *const values = select_chain->values;
+
+                if (traverse != 0)
+                {
+                    for (size_t v = 0; v < values->count; ++v)
+                    {
+                        if (job->action_key != NULL)
+                        {
+                            job->action_key(select_chain->key, job->context, _worker);
+                        }
+                        if (job->action_data != NULL)
+                        {
+                            job->action_data(values->datas[v], job->context, _worker);
+                        }
+                    }
+                } else {
+                    if (job->del_data != NULL)
+                    {
+                        for (size_t v = 0; v < values->count; ++v)
+                        {
+                            job->del_data(values->datas[v], job->context, _worker);
+                        }
+                    }
+                    if ( (job->del_key != NULL) && (hash_multimap->key_size == 0) )
+                    {
+                        job->del_key(select_chain->key, job->context, _worker);
+                    }
+
+                    if (bit_lowest(values->capacity) >= C_HASH_MULTIMAP_VALUES_CLASSES)
+                    {
+#if defined(C_HASH_MULTIMAP_THREADS)
+                        pthread_mutex_lock(&job->heap_lock);
+#endif
+                        memory_free(hash_multimap, values, values_size(hash_multimap, values->capacity));
+#if defined(C_HASH_MULTIMAP_THREADS)
+                        pthread_mutex_unlock(&job->heap_lock);
+#endif
+                        ++values_freed;
+                    }
+                }
+
+                select_chain = select_chain->next_chain;
+            }
+        }
+    }
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    __atomic_add_fetch(&job->values_freed, values_freed, __ATOMIC_RELAXED);
+#else
+    job->values_freed += values_freed;
+#endif
+}
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+// Переносит цепочки из диапазонов текущих слотов в новые слоты задания, пока незанятые диапазоны
+// не кончатся. Вызывается каждым исполнителем параллельного перестроения.
+// Исполнители переносят цепочки в одни и те же новые слоты, поэтому цепочка встраивается в начало
+// нового слота атомарной заменой.
+static void rebuild_task(void *const _job,
+                         const size_t _worker)
+{
+    c_hash_multimap_job *const job = _job;
+    const c_hash_multimap *const hash_multimap = job->hash_multimap;
+    c_hash_multimap_chain **const new_slots = job->new_slots;
+    const uint64_t *const occupied = slots_occupied(hash_multimap, hash_multimap->slots,
+                                                    hash_multimap->slots_count);
+    uint64_t *const new_occupied = slots_occupied(hash_multimap, new_slots, job->new_slots_count);
+
+    (void)_worker;
+
+    for (;;)
+    {
+        const size_t range = __atomic_fetch_add(&job->range_next, 1, __ATOMIC_RELAXED);
+        if (range >= job->slots_ranges)
+        {
+            break;
+        }
+
+        const size_t begin = range * C_HASH_MULTIMAP_PARALLEL_RANGE;
+        const size_t end = (hash_multimap->slots_count - begin < C_HASH_MULTIMAP_PARALLEL_RANGE) ?
+                           hash_multimap->slots_count : begin + C_HASH_MULTIMAP_PARALLEL_RANGE;
+
+        for (size_t s = slot_next(occupied, begin, end); s < end; s = slot_next(occupied, s + 1, end))
+        {
+            c_hash_multimap_chain *select_chain = hash_multimap->slots[s],
+                                  *relocate_chain;
+            while (select_chain != NULL)
+            {
+                relocate_chain = select_chain;
+                select_chain = select_chain->next_chain;
+
+                const size_t presented_k_hash = hash_present(hash_multimap,
+                                                             relocate_chain->k_hash,
+                                                             job->new_slots_count);
+
+                c_hash_multimap_chain *head = __atomic_load_n(&new_slots[presented_k_hash], __ATOMIC_RELAXED);
+                do
+                {
+                    C_HASH_MULTIMAP_STORE(relocate_chain->next_chain, head);
+                } while (__atomic_compare_exchange_n(&new_slots[presented_k_hash], &head, relocate_chain,
+                                                     1, __ATOMIC_RELEASE, __ATOMIC_RELAXED) == 0);
+                if (head == NULL)
+                {
+                    __atomic_fetch_or(&new_occupied[presented_k_hash / C_HASH_MULTIMAP_OCCUPIED_BITS],
+                                      (uint64_t)1 << (presented_k_hash % C_HASH_MULTIMAP_OCCUPIED_BITS),
+                                      __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+}
+#endif
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+// Точка входа потока встроенного пула.
+static void *worker_main(void *const _worker)
+{
+    const c_hash_multimap_worker *const worker = _worker;
+    worker->task(worker->job, worker->worker);
+    return NULL;
+}
+#endif
+
+// Выполняет заданную задачу параллельного обхода на исполнителях задания и дожидается ее завершения.
+// Вызывающий должен удерживать блокировки всех полос.
+static void job_run(c_hash_multimap_job *const _job,
+                    void (*const _task)(void *const _job, const size_t _worker))
+{
+    const c_hash_multimap *const hash_multimap = _job->hash_multimap;
+
+    _job->slots_ranges = hash_multimap->slots_count / C_HASH_MULTIMAP_PARALLEL_RANGE +
+                         (hash_multimap->slots_count % C_HASH_MULTIMAP_PARALLEL_RANGE != 0);
+    _job->ranges_count = _job->slots_ranges +
+                         hash_multimap->rehash_slots_count / C_HASH_MULTIMAP_PARALLEL_RANGE +
+                         (hash_multimap->rehash_slots_count % C_HASH_MULTIMAP_PARALLEL_RANGE != 0);
+    _job->range_next = 0;
+    _job->values_freed = 0;
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    const c_hash_multimap_executor *const executor = _job->executor;
+
+    size_t workers_count = (executor != NULL) ? executor->workers_count : 0;
+    if (workers_count == 0)
+    {
+    #if defined(_SC_NPROCESSORS_ONLN)
+        const long cpus_count = sysconf(_SC_NPROCESSORS_ONLN);
+        workers_count = (cpus_count > 0) ? (size_t)cpus_count : 1;
+    #else
+        workers_count = 1;
+    #endif
+    }
+    // Исполнителей больше, чем диапазонов, не требуется.
+    if (workers_count > _job->ranges_count)
+    {
+        workers_count = _job->ranges_count;
+    }
+    if (workers_count == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_init(&_job->heap_lock, NULL);
+
+    if ( (executor != NULL) && (executor->run != NULL) )
+    {
+        executor->run(executor->context, _task, _job, workers_count);
+    } else {
+        if (workers_count > C_HASH_MULTIMAP_WORKERS_MAX)
+        {
+            workers_count = C_HASH_MULTIMAP_WORKERS_MAX;
+        }
+
+        // Вызывающий поток является исполнителем 0. Если поток создать не удалось, его диапазоны
+        // заберут остальные исполнители.
+        pthread_t threads[C_HASH_MULTIMAP_WORKERS_MAX];
+        c_hash_multimap_worker workers[C_HASH_MULTIMAP_WORKERS_MAX];
+        size_t threads_count = 1;
+        for (; threads_count < workers_count; ++threads_count)
+        {
+            workers[threads_count].job = _job;
+            workers[threads_count].task = _task;
+            workers[threads_count].worker = threads_count;
+            if (pthread_create(&threads[threads_count], NULL, worker_main, &workers[threads_count]) != 0)
+            {
+                break;
+            }
+        }
+
+        _task(_job, 0);
+
+        for (size_t t = 1; t < threads_count; ++t)
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&_job->heap_lock);
+#else
+    _task(_job, 0);
+#endif
+}
+
+// Переносит все цепочки в новые слоты заданного ненулевого количества.
+// Количество слотов должно быть приведено при помощи slots_round().
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t slots_rebuild(c_hash_multimap *const _hash_multimap,
+                               const size_t _slots_count)
+{
+    c_hash_multimap_chain **new_slots;
+    uint8_t *new_ctrl;
+
+    const ptrdiff_t r_code = slots_alloc(_hash_multimap, _slots_count, &new_slots, &new_ctrl);
+    if (r_code < 0)
+    {
+        return r_code;
+    }
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Описание новых слотов для читателей без блокировок.
+    c_hash_multimap_table *new_table = NULL;
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        heap_lock(_hash_multimap);
+        new_table = memory_alloc(_hash_multimap, sizeof(c_hash_multimap_table));
+        heap_unlock(_hash_multimap);
+        if (new_table == NULL)
+        {
+            slots_free(_hash_multimap, new_slots, new_ctrl, _slots_count);
+            return -2;
+        }
+
+        // Пока цепочки переносятся, читатель может пропустить перенесенную цепочку.
+        __atomic_store_n(&_hash_multimap->slots_seq, _hash_multimap->slots_seq + 1, __ATOMIC_RELAXED);
+    }
+#endif
+
+    ++_hash_multimap->resizes_count;
+
+    // Проходим по всем слотам.
+    size_t count = _hash_multimap->chains_count;
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Большие таблицы механизма цепочек перестраиваются параллельно.
+    if ( (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_CHAINED) &&
+         (_hash_multimap->rebuild_parallel != 0) &&
+         (count >= _hash_multimap->rebuild_parallel) &&
+         (_hash_multimap->rehash_slots == NULL) )
+    {
+        c_hash_multimap_job job;
+        job_init(&job, _hash_multimap, NULL, &_hash_multimap->rebuild_executor);
+        job.new_slots = new_slots;
+        job.new_slots_count = _slots_count;
+        job_run(&job, rebuild_task);
+
+        count = 0;
+    }
+#endif
+    const uint64_t *const occupied = slots_occupied(_hash_multimap, _hash_multimap->slots,
+                                                    _hash_multimap->slots_count);
+    uint64_t *const new_occupied = slots_occupied(_hash_multimap, new_slots, _slots_count);
+    for (size_t s = slot_next(occupied, 0, _hash_multimap->slots_count);
+         (s < _hash_multimap->slots_count)&&(count > 0);
+         s = slot_next(occupied, s + 1, _hash_multimap->slots_count))
+    {
+        // Проходим по всем цепочкам слота.
+        c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, _hash_multimap->slots, s),
+                              *relocate_chain;
+        while (select_chain != NULL)
+        {
+            relocate_chain = select_chain;
+            select_chain = select_chain->next_chain;
+
+            if (new_ctrl != NULL)
+            {
+                // В новых слотах надгробий нет, цепочка занимает первый пустой слот.
+                const size_t index = open_free(new_ctrl, _slots_count, relocate_chain->k_hash);
+                new_ctrl[index] = C_HASH_MULTIMAP_TAG(relocate_chain->k_hash);
+                new_slots[index] = relocate_chain;
+                slot_occupy(_hash_multimap, new_occupied, index);
+            } else {
+                // Вычисляем хэш переносимой цепочки, приведенный к новому количеству слотов.
+                const size_t presented_k_hash = hash_present(_hash_multimap,
+                                                             relocate_chain->k_hash,
+                                                             _slots_count);
+
+                // Переносим.
+                if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+                {
+                    bucket_push(slot_bucket(_hash_multimap, new_slots, presented_k_hash), relocate_chain);
+                } else {
+                    C_HASH_MULTIMAP_STORE(relocate_chain->next_chain, new_slots[presented_k_hash]);
+                    new_slots[presented_k_hash] = relocate_chain;
+                }
+                slot_occupy(_hash_multimap, new_occupied, presented_k_hash);
+            }
+
+            --count;
+        }
+    }
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        // Старые слоты освобождаются вместе с прежним описанием, когда их не просматривает ни один читатель.
+        _hash_multimap->slots = new_slots;
+        _hash_multimap->slots_count = _slots_count;
+        table_publish(_hash_multimap, new_table);
+
+        __atomic_store_n(&_hash_multimap->slots_seq, _hash_multimap->slots_seq + 1, __ATOMIC_RELEASE);
+
+        return 1;
+    }
+#endif
+
+    // Освобождаем память из-под старых слотов.
+    slots_free(_hash_multimap, _hash_multimap->slots, _hash_multimap->ctrl, _hash_multimap->slots_count);
+
+    // Используем новые слоты.
+    _hash_multimap->slots = new_slots;
+    _hash_multimap->ctrl = new_ctrl;
+    _hash_multimap->slots_count = _slots_count;
+
+    if (new_ctrl != NULL)
+    {
+        _hash_multimap->growth_left = open_limit(_hash_multimap, _slots_count) - _hash_multimap->chains_count;
+    }
+
+    return 1;
+}
+
+// Начинает постепенное перестроение механизма цепочек: текущие слоты становятся старыми,
+// а новыми становятся пустые слоты заданного количества.
+// Перестроение не должно уже выполняться.
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t rehash_start(c_hash_multimap *const _hash_multimap,
+                              const size_t _slots_count)
+{
+    c_hash_multimap_chain **new_slots;
+    uint8_t *new_ctrl;
+
+    const ptrdiff_t r_code = slots_alloc(_hash_multimap, _slots_count, &new_slots, &new_ctrl);
+    if (r_code < 0)
+    {
+        return r_code;
+    }
+
+    _hash_multimap->rehash_slots = _hash_multimap->slots;
+    _hash_multimap->rehash_slots_count = _hash_multimap->slots_count;
+    _hash_multimap->rehash_index = 0;
+
+    ++_hash_multimap->resizes_count;
+
+    _hash_multimap->slots = new_slots;
+    _hash_multimap->slots_count = _slots_count;
+
+    return 1;
+}
+
+// Переносит в текущие слоты цепочки не более чем _steps непустых старых слотов постепенного
+// перестроения, пустых старых слотов при этом просматривается не более чем
+// в C_HASH_MULTIMAP_REHASH_VISITS раз больше.
+// Когда перенесены цепочки всех старых слотов, старые слоты освобождаются.
+// Если перестроение не выполняется, ничего не делает.
+static void rehash_advance(c_hash_multimap *const _hash_multimap,
+                           size_t _steps)
+{
+    if (_hash_multimap->rehash_slots == NULL)
+    {
+        return;
+    }
+
+    size_t visits = (_steps > SIZE_MAX / C_HASH_MULTIMAP_REHASH_VISITS) ?
+                    SIZE_MAX : _steps * C_HASH_MULTIMAP_REHASH_VISITS;
+
+    uint64_t *const old_occupied = slots_occupied(_hash_multimap, _hash_multimap->rehash_slots,
+                                                   _hash_multimap->rehash_slots_count);
+    uint64_t *const occupied = slots_occupied(_hash_multimap, _hash_multimap->slots, _hash_multimap->slots_count);
+
+    while ( (_steps > 0) && (visits > 0) &&
+            (_hash_multimap->rehash_index < _hash_multimap->rehash_slots_count) )
+    {
+        // Пустые старые слоты пропускаются по битовой карте, но учитываются как просмотренные.
+        const size_t index = slot_next(old_occupied, _hash_multimap->rehash_index, _hash_multimap->rehash_slots_count);
+        if (index - _hash_multimap->rehash_index >= visits)
+        {
+            _hash_multimap->rehash_index += visits;
+            break;
+        }
+        visits -= index - _hash_multimap->rehash_index;
+        _hash_multimap->rehash_index = index;
+        if (index == _hash_multimap->rehash_slots_count)
+        {
+            break;
+        }
+
+        c_hash_multimap_chain **const old_slot = &_hash_multimap->rehash_slots[_hash_multimap->rehash_index++];
+
+        // Переносим все цепочки старого слота.
+        c_hash_multimap_chain *select_chain = *old_slot,
+                              *relocate_chain;
+        while (select_chain != NULL)
+        {
+            relocate_chain = select_chain;
+            select_chain = select_chain->next_chain;
+
+            const size_t presented_k_hash = hash_present(_hash_multimap,
+                                                         relocate_chain->k_hash,
+                                                         _hash_multimap->slots_count);
+            relocate_chain->next_chain = _hash_multimap->slots[presented_k_hash];
+            _hash_multimap->slots[presented_k_hash] = relocate_chain;
+            slot_occupy(_hash_multimap, occupied, presented_k_hash);
+        }
+        *old_slot = NULL;
+        slot_vacate(_hash_multimap, old_occupied, index);
+
+        --_steps;
+    }
+
+    if (_hash_multimap->rehash_index == _hash_multimap->rehash_slots_count)
+    {
+        slots_free(_hash_multimap, _hash_multimap->rehash_slots, NULL, _hash_multimap->rehash_slots_count);
+        _hash_multimap->rehash_slots = NULL;
+        _hash_multimap->rehash_slots_count = 0;
+        _hash_multimap->rehash_index = 0;
+    }
+}
+
+// Проверяет, хранит ли цепочка заданный ключ.
+// Ключи, хранящиеся внутри цепочек, сравниваются без вызова функции сравнения: ключи
+// распространенных размеров - словами, остальные - memcmp().
+// Если ключи идентичны, возвращает > 0, иначе возвращает 0.
+static inline size_t key_equal(const c_hash_multimap *const _hash_multimap,
+                               const c_hash_multimap_chain *const _chain,
+                               const void *const _key)
+{
+    if (_hash_multimap->key_size == 0)
+    {
+        C_HASH_MULTIMAP_COUNT(_hash_multimap, key_comparisons, 1);
+        return (_hash_multimap->comp_key(_chain->key, _key) > 0);
+    }
+
+    // Ключ расположен сразу за цепочкой, поэтому читать указатель на него не нужно.
+    const void *const key = _chain + 1;
+    if (_hash_multimap->key_string != 0)
+    {
+        return (strcmp(key, _key) == 0);
+    }
+    switch (_hash_multimap->key_size)
+    {
+        case sizeof(uint32_t):
+        {
+            uint32_t a, b;
+            memcpy(&a, key, sizeof(uint32_t));
+            memcpy(&b, _key, sizeof(uint32_t));
+            return (a == b);
+        }
+        case sizeof(uint64_t):
+        {
+            uint64_t a, b;
+            memcpy(&a, key, sizeof(uint64_t));
+            memcpy(&b, _key, sizeof(uint64_t));
+            return (a == b);
+        }
+        case 2 * sizeof(uint64_t):
+        {
+            uint64_t a[2], b[2];
+            memcpy(a, key, sizeof(a));
+            memcpy(b, _key, sizeof(b));
+            return ( (a[0] == b[0]) && (a[1] == b[1]) );
+        }
+        default:
+        {
+            return (memcmp(key, _key, _hash_multimap->key_size) == 0);
+        }
+    }
+}
+
+// Ищет цепочку, которая хранит заданный ключ, в списке заданного слота механизма цепочек.
+// Если цепочка найдена и _place != NULL, в заданное расположение помещается место цепочки.
+// Если цепочки нет, возвращает NULL.
+static c_hash_multimap_chain *chain_find_list(const c_hash_multimap *const _hash_multimap,
+                                              c_hash_multimap_chain **const _slots,
+                                              const size_t _index,
+                                              const void *const _key,
+                                              const size_t _k_hash,
+                                              c_hash_multimap_place *const _place)
+{
+    c_hash_multimap_chain *select_chain = _slots[_index],
+                          *prev_chain = NULL;
+    while (select_chain != NULL)
+    {
+        C_HASH_MULTIMAP_COUNT(_hash_multimap, probes, 1);
+        if (select_chain->k_hash == _k_hash)
+        {
+            if (key_equal(_hash_multimap, select_chain, _key) > 0)
+            {
+                if (_place != NULL)
+                {
+                    _place->index = _index;
+                    _place->prev_chain = prev_chain;
+                    _place->slots = _slots;
+                }
+                return select_chain;
+            }
+        }
+        prev_chain = select_chain;
+        select_chain = select_chain->next_chain;
+    }
+
+    return NULL;
+}
+
+// Ищет цепочку, которая хранит заданный ключ, в корзине с заданным индексом.
+// С ключом сравниваются только цепочки корзины с совпавшей меткой, продолжение списка
+// просматривается как список механизма цепочек.
+// Если цепочка найдена и _place != NULL, в заданное расположение помещается место цепочки.
+// Если цепочки нет, возвращает NULL.
+static c_hash_multimap_chain *chain_find_bucket(const c_hash_multimap *const _hash_multimap,
+                                                c_hash_multimap_chain *const *const _slots,
+                                                const size_t _index,
+                                                const void *const _key,
+                                                const size_t _k_hash,
+                                                c_hash_multimap_place *const _place)
+{
+    const c_hash_multimap_bucket *const bucket = slot_bucket(_hash_multimap, _slots, _index);
+    const uint8_t tag = C_HASH_MULTIMAP_BUCKET_TAG(_k_hash);
+
+    c_hash_multimap_chain *select_chain = NULL,
+                          *prev_chain = NULL;
+    for (size_t e = 0; e < bucket->count; ++e)
+    {
+        if (bucket->tags[e] != tag)
+        {
+            continue;
+        }
+        C_HASH_MULTIMAP_COUNT(_hash_multimap, probes, 1);
+        if ( (bucket->entries[e]->k_hash == _k_hash) &&
+             (key_equal(_hash_multimap, bucket->entries[e], _key) > 0) )
+        {
+            select_chain = bucket->entries[e];
+            prev_chain = (e > 0) ? bucket->entries[e - 1] : NULL;
+            break;
+        }
+    }
+
+    if (select_chain == NULL)
+    {
+        prev_chain = bucket->entries[C_HASH_MULTIMAP_BUCKET_ENTRIES - 1];
+        select_chain = bucket->overflow;
+        while (select_chain != NULL)
+        {
+            C_HASH_MULTIMAP_COUNT(_hash_multimap, probes, 1);
+            if ( (select_chain->k_hash == _k_hash) &&
+                 (key_equal(_hash_multimap, select_chain, _key) > 0) )
+            {
+                break;
+            }
+            prev_chain = select_chain;
+            select_chain = select_chain->next_chain;
+        }
+    }
+
+    if ( (select_chain != NULL) && (_place != NULL) )
+    {
+        _place->index = _index;
+        _place->prev_chain = prev_chain;
+        _place->slots = (c_hash_multimap_chain**)_slots;
+    }
+
+    return select_chain;
+}
+
+// Ищет цепочку, которая хранит заданный ключ.
+// Хэш-мультиотображение должно иметь хотя бы один слот.
+// Если цепочка найдена и _place != NULL, в заданное расположение помещается место цепочки.
+// Если цепочки нет, возвращает NULL.
+static c_hash_multimap_chain *chain_find(const c_hash_multimap *const _hash_multimap,
+                                         const void *const _key,
+                                         const size_t _k_hash,
+                                         c_hash_multimap_place *const _place)
+{
+    C_HASH_MULTIMAP_COUNT(_hash_multimap, lookups, 1);
+
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        const size_t groups_mask = _hash_multimap->slots_count / C_HASH_MULTIMAP_GROUP - 1;
+        const uint8_t tag = C_HASH_MULTIMAP_TAG(_k_hash);
+        size_t group = C_HASH_MULTIMAP_GROUP_FIRST(_k_hash, groups_mask);
+        for (size_t step = 1; ; ++step)
+        {
+            const uint8_t *const ctrl = _hash_multimap->ctrl + group * C_HASH_MULTIMAP_GROUP;
+            // Проверяем только слоты группы, метка которых совпадает с меткой хэша.
+            uint64_t match = group_match(ctrl, tag);
+            while (match != 0)
+            {
+                const size_t index = group * C_HASH_MULTIMAP_GROUP +
+                                     (bit_lowest(match) >> C_HASH_MULTIMAP_LANE_SHIFT);
+                c_hash_multimap_chain *const select_chain = _hash_multimap->slots[index];
+                C_HASH_MULTIMAP_COUNT(_hash_multimap, probes, 1);
+                if ( (select_chain != NULL) && (select_chain->k_hash == _k_hash) )
+                {
+                    if (key_equal(_hash_multimap, select_chain, _key) > 0)
+                    {
+                        if (_place != NULL)
+                        {
+                            _place->index = index;
+                        }
+                        return select_chain;
+                    }
+                }
+                match &= match - 1;
+            }
+            // Группа с пустым слотом завершает последовательность проб.
+            if (group_match_empty(ctrl) != 0)
+            {
+                return NULL;
+            }
+            group = (group + step) & groups_mask;
+        }
+    }
+
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+    {
+        return chain_find_bucket(_hash_multimap,
+                                 _hash_multimap->slots,
+                                 hash_present(_hash_multimap, _k_hash, _hash_multimap->slots_count),
+                                 _key, _k_hash, _place);
+    }
+
+    c_hash_multimap_chain *const select_chain = chain_find_list(_hash_multimap,
+                                                                _hash_multimap->slots,
+                                                                hash_present(_hash_multimap, _k_hash,
+                                                                             _hash_multimap->slots_count),
+                                                                _key, _k_hash, _place);
+    if ( (select_chain != NULL) || (_hash_multimap->rehash_slots == NULL) )
+    {
+        return select_chain;
+    }
+
+    // До окончания постепенного перестроения цепочка может оставаться в старых слотах.
+    return chain_find_list(_hash_multimap,
+                           _hash_multimap->rehash_slots,
+                           hash_present(_hash_multimap, _k_hash, _hash_multimap->rehash_slots_count),
+                           _key, _k_hash, _place);
+}
+
+// Начинает чтение по ключу с заданным неприведенным хэшем.
+// При чтении без блокировок возвращает запись читателя текущего потока,
+// иначе блокирует полосу ключа на чтение и возвращает NULL.
+static inline c_hash_multimap_reader *read_begin(const c_hash_multimap *const _hash_multimap,
+                                                 const size_t _k_hash)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        c_hash_multimap_reader *const reader = reader_get(_hash_multimap);
+        if (reader != NULL)
+        {
+            reader_enter(_hash_multimap, reader);
+            return reader;
+        }
+        // Если памяти под запись читателя нет, поток читает под блокировкой полосы,
+        // которая исключает писателей так же, как и без чтения без блокировок.
+    }
+#endif
+
+    stripe_lock(_hash_multimap, _k_hash, 0);
+
+    return NULL;
+}
+
+// Завершает чтение, начатое read_begin().
+static inline void read_end(const c_hash_multimap *const _hash_multimap,
+                            const size_t _k_hash,
+                            c_hash_multimap_reader *const _reader)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_reader != NULL)
+    {
+        reader_exit(_reader);
+        return;
+    }
+#else
+    (void)_reader;
+#endif
+
+    stripe_unlock(_hash_multimap, _k_hash);
+}
+
+// Ищет цепочку, которая хранит заданный ключ, для чтения, начатого read_begin().
+// Если цепочки нет, возвращает NULL.
+static const c_hash_multimap_chain *chain_read(const c_hash_multimap *const _hash_multimap,
+                                               const void *const _key,
+                                               const size_t _k_hash)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        C_HASH_MULTIMAP_COUNT(_hash_multimap, lookups, 1);
+        for (;;)
+        {
+            const size_t seq = __atomic_load_n(&_hash_multimap->slots_seq, __ATOMIC_ACQUIRE);
+
+            const c_hash_multimap_table *const table = C_HASH_MULTIMAP_LOAD(_hash_multimap->table);
+            if (table != NULL)
+            {
+                const size_t index = hash_present(_hash_multimap, _k_hash, table->slots_count);
+                c_hash_multimap_chain *const *const list = slot_list(_hash_multimap, table->slots, index);
+                const c_hash_multimap_chain *select_chain = C_HASH_MULTIMAP_LOAD(*list);
+                while (select_chain != NULL)
+                {
+                    C_HASH_MULTIMAP_COUNT(_hash_multimap, probes, 1);
+                    if ( (select_chain->k_hash == _k_hash) &&
+                         (key_equal(_hash_multimap, select_chain, _key) > 0) )
+                    {
+                        return select_chain;
+                    }
+                    select_chain = C_HASH_MULTIMAP_LOAD(select_chain->next_chain);
+                }
+            }
+
+            // Промах достоверен, только если во время поиска цепочки не переносились в новые слоты.
+            if ( ((seq & 1) == 0) &&
+                 (__atomic_load_n(&_hash_multimap->slots_seq, __ATOMIC_ACQUIRE) == seq) )
+            {
+                return NULL;
+            }
+            sched_yield();
+        }
+    }
+#endif
+
+    if (counter_load(_hash_multimap, &_hash_multimap->nodes_count) == 0)
+    {
+        return NULL;
+    }
+
+    return chain_find(_hash_multimap, _key, _k_hash, NULL);
+}
+
+// Подкачивает в кэш слот, с которого начинается поиск цепочки с заданным хэшем.
+// Хэш-мультиотображение должно иметь хотя бы один слот.
+static inline void slot_prefetch(const c_hash_multimap *const _hash_multimap,
+                                 const size_t _k_hash)
+{
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        const size_t groups_mask = _hash_multimap->slots_count / C_HASH_MULTIMAP_GROUP - 1;
+        const size_t index = C_HASH_MULTIMAP_GROUP_FIRST(_k_hash, groups_mask) * C_HASH_MULTIMAP_GROUP;
+        C_HASH_MULTIMAP_PREFETCH(_hash_multimap->ctrl + index);
+        C_HASH_MULTIMAP_PREFETCH(_hash_multimap->slots + index);
+        return;
+    }
+
+    // Корзина выровнена на строку кэша и подкачивается целиком.
+    C_HASH_MULTIMAP_PREFETCH(slot_list(_hash_multimap, _hash_multimap->slots,
+                                       hash_present(_hash_multimap, _k_hash, _hash_multimap->slots_count)));
+}
+
+// Возвращает первую цепочку, которую поиск цепочки с заданным хэшем будет сравнивать, или NULL.
+// Хэш-мультиотображение должно иметь хотя бы один слот.
+static inline const c_hash_multimap_chain *chain_candidate(const c_hash_multimap *const _hash_multimap,
+                                                           const size_t _k_hash)
+{
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        const size_t groups_mask = _hash_multimap->slots_count / C_HASH_MULTIMAP_GROUP - 1;
+        const size_t index = C_HASH_MULTIMAP_GROUP_FIRST(_k_hash, groups_mask) * C_HASH_MULTIMAP_GROUP;
+        const uint64_t match = group_match(_hash_multimap->ctrl + index, C_HASH_MULTIMAP_TAG(_k_hash));
+        if (match == 0)
+        {
+            return NULL;
+        }
+        return _hash_multimap->slots[index + (bit_lowest(match) >> C_HASH_MULTIMAP_LANE_SHIFT)];
+    }
+
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+    {
+        const c_hash_multimap_bucket *const bucket = slot_bucket(_hash_multimap, _hash_multimap->slots,
+                                                                 hash_present(_hash_multimap, _k_hash,
+                                                                              _hash_multimap->slots_count));
+        const uint8_t tag = C_HASH_MULTIMAP_BUCKET_TAG(_k_hash);
+        for (size_t e = 0; e < bucket->count; ++e)
+        {
+            if (bucket->tags[e] == tag)
+            {
+                return bucket->entries[e];
+            }
+        }
+        return bucket->overflow;
+    }
+
+    return _hash_multimap->slots[hash_present(_hash_multimap, _k_hash, _hash_multimap->slots_count)];
+}
+
+// Подкачивает в кэш первую цепочку, которую поиск цепочки с заданным хэшем будет сравнивать.
+// Слот к этому моменту уже должен быть подкачан slot_prefetch().
+static inline void chain_prefetch(const c_hash_multimap *const _hash_multimap,
+                                  const size_t _k_hash)
+{
+    const c_hash_multimap_chain *const select_chain = chain_candidate(_hash_multimap, _k_hash);
+    if (select_chain != NULL)
+    {
+        C_HASH_MULTIMAP_PREFETCH(select_chain);
+    }
+}
+
+// Если первая цепочка, которую поиск цепочки с заданным хэшем будет сравнивать, хранит такой же хэш,
+// подкачивает в кэш ее ключ и массив данных.
+// Цепочка к этому моменту уже должна быть подкачана chain_prefetch().
+static inline void values_prefetch(const c_hash_multimap *const _hash_multimap,
+                                   const size_t _k_hash)
+{
+    const c_hash_multimap_chain *const select_chain = chain_candidate(_hash_multimap, _k_hash);
+    if ( (select_chain != NULL) && (select_chain->k_hash == _k_hash) )
+    {
+        C_HASH_MULTIMAP_PREFETCH(select_chain->key);
+        C_HASH_MULTIMAP_PREFETCH(select_chain->values);
+    }
+}
+
+// Встраивает новую цепочку в слоты.
+// Цепочки с таким же ключом в хэш-мультиотображении быть не должно.
+// Для открытой адресации должно выполняться условие growth_left > 0.
+static void chain_attach(c_hash_multimap *const _hash_multimap,
+                         c_hash_multimap_chain *const _chain)
+{
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        const size_t index = open_free(_hash_multimap->ctrl, _hash_multimap->slots_count, _chain->k_hash);
+        // Повторно используемое надгробие запас свободных слотов не уменьшает.
+        if (_hash_multimap->ctrl[index] == C_HASH_MULTIMAP_CTRL_EMPTY)
+        {
+            --_hash_multimap->growth_left;
+        }
+        _hash_multimap->ctrl[index] = C_HASH_MULTIMAP_TAG(_chain->k_hash);
+        _hash_multimap->slots[index] = _chain;
+        _chain->next_chain = NULL;
+        slot_occupy(_hash_multimap,
+                    slots_occupied(_hash_multimap, _hash_multimap->slots, _hash_multimap->slots_count),
+                    index);
+        return;
+    }
+
+    const size_t presented_k_hash = hash_present(_hash_multimap, _chain->k_hash,
+                                                 _hash_multimap->slots_count);
+
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+    {
+        c_hash_multimap_bucket *const bucket = slot_bucket(_hash_multimap, _hash_multimap->slots,
+                                                           presented_k_hash);
+        if (bucket->count == 0)
+        {
+            slot_occupy(_hash_multimap,
+                        slots_occupied(_hash_multimap, _hash_multimap->slots, _hash_multimap->slots_count),
+                        presented_k_hash);
+        }
+        bucket_push(bucket, _chain);
+        return;
+    }
+    _chain->next_chain = _hash_multimap->slots[presented_k_hash];
+    // Цепочка становится видна читателям без блокировок уже заполненной.
+    C_HASH_MULTIMAP_STORE(_hash_multimap->slots[presented_k_hash], _chain);
+    if (_chain->next_chain == NULL)
+    {
+        slot_occupy(_hash_multimap,
+                    slots_occupied(_hash_multimap, _hash_multimap->slots, _hash_multimap->slots_count),
+                    presented_k_hash);
+    }
+}
+
+// Ампутирует цепочку из слотов.
+static void chain_detach(c_hash_multimap *const _hash_multimap,
+                         c_hash_multimap_chain *const _chain,
+                         const c_hash_multimap_place *const _place)
+{
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        // Если в группе есть пустой слот, ни одна последовательность проб через группу не проходила,
+        // и слот можно сделать пустым. Иначе слот становится надгробием.
+        const uint8_t *const ctrl = _hash_multimap->ctrl + (_place->index & ~(C_HASH_MULTIMAP_GROUP - 1));
+        if (group_match_empty(ctrl) != 0)
+        {
+            _hash_multimap->ctrl[_place->index] = C_HASH_MULTIMAP_CTRL_EMPTY;
+            ++_hash_multimap->growth_left;
+        } else {
+            _hash_multimap->ctrl[_place->index] = C_HASH_MULTIMAP_CTRL_DELETED;
+        }
+        _hash_multimap->slots[_place->index] = NULL;
+        slot_vacate(_hash_multimap,
+                    slots_occupied(_hash_multimap, _hash_multimap->slots, _hash_multimap->slots_count),
+                    _place->index);
+        return;
+    }
+
+    // Связь ампутированной цепочки сохраняется, чтобы читатели без блокировок, просматривающие ее,
+    // могли продолжить поиск.
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+    {
+        c_hash_multimap_bucket *const bucket = slot_bucket(_hash_multimap, _place->slots, _place->index);
+        if (bucket_remove(bucket, _chain, _place->prev_chain) != 0)
+        {
+            slot_vacate(_hash_multimap, slots_occupied(_hash_multimap, _place->slots, _hash_multimap->slots_count),
+                        _place->index);
+        }
+        return;
+    }
+
+    if (_place->prev_chain == NULL)
+    {
+        C_HASH_MULTIMAP_STORE(_place->slots[_place->index], _chain->next_chain);
+        if (_chain->next_chain == NULL)
+        {
+            const size_t slots_count = (_place->slots == _hash_multimap->slots) ? _hash_multimap->slots_count :
+                                                                                 _hash_multimap->rehash_slots_count;
+            slot_vacate(_hash_multimap, slots_occupied(_hash_multimap, _place->slots, slots_count), _place->index);
+        }
+    } else {
+        C_HASH_MULTIMAP_STORE(_place->prev_chain->next_chain, _chain->next_chain);
+    }
+}
+
+// Переносит данные цепочки в массив заданной вместимости.
+// В случае успеха возвращает > 0, в случае нехватки памяти возвращает < 0.
+static ptrdiff_t values_move(c_hash_multimap *const _hash_multimap,
+                             c_hash_multimap_chain *const _chain,
+                             const size_t _capacity)
+{
+    c_hash_multimap_values *const new_values = values_alloc(_hash_multimap, _capacity);
+    if (new_values == NULL)
+    {
+        return -1;
+    }
+
+    c_hash_multimap_values *const old_values = _chain->values;
+
+    values_assign(_hash_multimap, new_values, old_values);
+    values_index_build(_hash_multimap, new_values);
+
+    C_HASH_MULTIMAP_STORE(_chain->values, new_values);
+    values_release(_hash_multimap, old_values);
+
+    return 1;
+}
+
+// Освобождает ампутированную цепочку, предварительно вызывая заданные функции удаления
+// для всех ее данных и ключа.
+// Если цепочку могут просматривать читатели без блокировок, освобождение откладывается.
+static void chain_release(c_hash_multimap *const _hash_multimap,
+                          c_hash_multimap_chain *const _chain,
+                          void (*const _del_key)(void *const _key),
+                          void (*const _del_data)(void *const _data))
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        retired_push(_hash_multimap, C_HASH_MULTIMAP_RETIRED_CHAIN, _chain, _del_key, _del_data);
+        return;
+    }
+#endif
+
+    c_hash_multimap_values *const values = _chain->values;
+    if (_del_data != NULL)
+    {
+        for (size_t v = 0; v < values->count; ++v)
+        {
+            _del_data(values->datas[v]);
+        }
+    }
+    if ( (_del_key != NULL) && (_hash_multimap->key_size == 0) )
+    {
+        _del_key(_chain->key);
+    }
+
+    chain_free(_hash_multimap, _chain);
+}
+
+// Добавляет данные в конец массива цепочки, при необходимости вдвое увеличивая его вместимость.
+// В случае успеха возвращает > 0, в случае ошибки возвращает < 0.
+static ptrdiff_t chain_push(c_hash_multimap *const _hash_multimap,
+                            c_hash_multimap_chain *const _chain,
+                            const void *const _data)
+{
+    if (_chain->values->count == _chain->values->capacity)
+    {
+        const size_t new_capacity = _chain->values->capacity << 1;
+        // Контроль переполнения.
+        if (new_capacity == 0)
+        {
+            return -1;
+        }
+        if (values_move(_hash_multimap, _chain, new_capacity) < 0)
+        {
+            return -1;
+        }
+    }
+
+    c_hash_multimap_values *const values = _chain->values;
+    values_set(_hash_multimap, values, values->count, _data);
+    if (values_indexed(_hash_multimap, values->capacity) != 0)
+    {
+        values_index_insert(values, values->count);
+    }
+    // Читатели без блокировок видят новое количество только после записи данных.
+    C_HASH_MULTIMAP_STORE(values->count, values->count + 1);
+
+    return 1;
+}
+
+// Удаляет из массива цепочки данные с заданным индексом, их место занимают последние данные.
+// В массиве должно оставаться хотя бы одно значение.
+// Если массив оказывается заполнен не более чем на четверть, его вместимость уменьшается вдвое.
+// В случае успеха возвращает > 0.
+// Если массив могут просматривать читатели без блокировок, данные удаляются из его копии,
+// и в случае нехватки памяти на копию возвращает < 0.
+static ptrdiff_t chain_remove(c_hash_multimap *const _hash_multimap,
+                              c_hash_multimap_chain *const _chain,
+                              const size_t _index)
+{
+    c_hash_multimap_values *const values = _chain->values;
+    const size_t count = values->count - 1;
+    const size_t capacity = (count <= values->capacity / 4) ? values->capacity / 2 : values->capacity;
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        c_hash_multimap_values *const new_values = values_alloc(_hash_multimap, capacity);
+        if (new_values == NULL)
+        {
+            return -1;
+        }
+
+        // Индекс прежней вместимости копируется и исправляется, иначе строится заново.
+        const size_t index_copy = (capacity == values->capacity) &&
+                                  (values_indexed(_hash_multimap, capacity) != 0);
+        values_assign(_hash_multimap, new_values, values);
+        if (index_copy != 0)
+        {
+            memcpy(values_index(new_values), values_index(values), 2 * capacity * sizeof(size_t));
+            values_index_remove(new_values, _index);
+        }
+        values_copy(_hash_multimap, new_values, _index, count);
+        new_values->count = count;
+        if (index_copy == 0)
+        {
+            values_index_build(_hash_multimap, new_values);
+        }
+
+        C_HASH_MULTIMAP_STORE(_chain->values, new_values);
+        values_release(_hash_multimap, values);
+
+        return 1;
+    }
+#endif
+
+    if (values_indexed(_hash_multimap, values->capacity) != 0)
+    {
+        values_index_remove(values, _index);
+    }
+    values_copy(_hash_multimap, values, _index, count);
+    values->count = count;
+
+    if (capacity < values->capacity)
+    {
+        // Если уменьшить массив не удалось, продолжаем использовать прежний.
+        values_move(_hash_multimap, _chain, capacity);
+    }
+
+    return 1;
+}
+
+// Уничтожает блокировки полос и пулов.
+static void stripes_free(c_hash_multimap *const _hash_multimap)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->stripes_count != 0)
+    {
+        for (size_t s = 0; s < _hash_multimap->stripes_count; ++s)
+        {
+            pthread_rwlock_destroy((pthread_rwlock_t*)(_hash_multimap->stripes + s * _hash_multimap->stripe_size));
+        }
+        pthread_mutex_destroy(&_hash_multimap->heap_lock);
+        memory_free(_hash_multimap, _hash_multimap->stripes,
+                    _hash_multimap->stripes_count * _hash_multimap->stripe_size);
+        _hash_multimap->stripes = NULL;
+        _hash_multimap->stripes_count = 0;
+    }
+#else
+    (void)_hash_multimap;
+#endif
+}
+
+// Функция генерации хэша по последовательности из _size байт.
+// Та же функция хэширует ключи, хранящиеся внутри цепочек (c_hash_multimap_config::key_size).
+// Если _size == 0, _bytes может быть равен NULL.
+size_t c_hash_multimap_hash_bytes(const void *const _bytes,
+                                  const size_t _size)
+{
+    return hash_bytes(_bytes, _size);
+}
+
+// Функция генерации хэша по ключу-строке, завершенной нулем.
+// Совпадает с хэшем строк, хранящихся внутри цепочек (c_hash_multimap_config::key_string).
+size_t c_hash_multimap_hash_string(const void *const _key)
+{
+    return hash_bytes(_key, strlen(_key));
+}
+
+// Функция генерации хэша по ключу, указывающему на uint32_t.
+size_t c_hash_multimap_hash_u32(const void *const _key)
+{
+    return hash_mix(*(const uint32_t*)_key);
+}
+
+// Функция генерации хэша по ключу, указывающему на uint64_t.
+size_t c_hash_multimap_hash_u64(const void *const _key)
+{
+    return hash_mix(*(const uint64_t*)_key);
+}
+
+// Функция генерации хэша по значению самого указателя-ключа (ключом является адрес).
+size_t c_hash_multimap_hash_pointer(const void *const _key)
+{
+    return hash_mix((uintptr_t)_key);
+}
+
+// Функция детального сравнения ключей-строк, завершенных нулем.
+size_t c_hash_multimap_comp_string(const void *const _key_a,
+                                   const void *const _key_b)
+{
+    return (strcmp(_key_a, _key_b) == 0);
+}
+
+// Функция детального сравнения ключей, указывающих на uint32_t.
+size_t c_hash_multimap_comp_u32(const void *const _key_a,
+                                const void *const _key_b)
+{
+    return (*(const uint32_t*)_key_a == *(const uint32_t*)_key_b);
+}
+
+// Функция детального сравнения ключей, указывающих на uint64_t.
+size_t c_hash_multimap_comp_u64(const void *const _key_a,
+                                const void *const _key_b)
+{
+    return (*(const uint64_t*)_key_a == *(const uint64_t*)_key_b);
+}
+
+// Функция детального сравнения указателей-ключей по адресу.
+size_t c_hash_multimap_comp_pointer(const void *const _key_a,
+                                    const void *const _key_b)
+{
+    return (_key_a == _key_b);
+}
+
+// Инициализирует параметры создания значениями по умолчанию.
+void c_hash_multimap_config_init(c_hash_multimap_config *const _config)
+{
+    if (_config == NULL)
+    {
+        return;
+    }
+
+    _config->allocator.alloc = NULL;
+    _config->allocator.free = NULL;
+    _config->allocator.context = NULL;
+
+    _config->pool_page_size = 0;
+
+    _config->pow2_slots = 0;
+    _config->hash_finalizer = 0;
+
+    _config->key_size = 0;
+    _config->key_string = 0;
+
+    _config->hash_data = NULL;
+    _config->data_index_capacity = 0;
+
+    _config->engine = C_HASH_MULTIMAP_ENGINE_CHAINED;
+
+    _config->rehash_step = 0;
+
+    _config->min_load_factor = 0.f;
+
+    _config->lock_stripes = 0;
+    _config->lock_free_reads = 0;
+
+    _config->rebuild_parallel = 0;
+    _config->rebuild_executor.run = NULL;
+    _config->rebuild_executor.context = NULL;
+    _config->rebuild_executor.workers_count = 0;
+}
+
+// Создание хэш-мультиотображения.
+// Позволяет создавать хэш-мультиотображение с нулем слотов.
+// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+c_hash_multimap *c_hash_multimap_create(size_t (*const _hash_key)(const void *const _key),
+                                        size_t (*const _comp_key)(const void *const _key_a,
+                                                                  const void *const _key_b),
+                                        size_t (*const _comp_data)(const void *const _data_a,
+                                                                   const void *const _data_b),
+                                        const size_t _slots_count,
+                                        const float _max_load_factor,
+                                        size_t *const _error)
+{
+    return c_hash_multimap_create_ex(_hash_key,
+                                     _comp_key,
+                                     _comp_data,
+                                     _slots_count,
+                                     _max_load_factor,
+                                     NULL,
+                                     _error);
+}
+
+// Создание хэш-мультиотображения с дополнительными параметрами.
+// Если _config == NULL, используются параметры по умолчанию.
+// Позволяет создавать хэш-мультиотображение с нулем слотов.
+// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+c_hash_multimap *c_hash_multimap_create_ex(size_t (*const _hash_key)(const void *const _key),
+                                           size_t (*const _comp_key)(const void *const _key_a,
+                                                                     const void *const _key_b),
+                                           size_t (*const _comp_data)(const void *const _data_a,
+                                                                      const void *const _data_b),
+                                           const size_t _slots_count,
+                                           const float _max_load_factor,
+                                           const c_hash_multimap_config *const _config,
+                                           size_t *const _error)
+{
+    c_hash_multimap_config config;
+    c_hash_multimap_config_init(&config);
+    if (_config != NULL)
+    {
+        config = *_config;
+    }
+
+    // Ключи, хранящиеся внутри цепочек, хэшируются и сравниваются без функций вызывающего.
+    if ( (_hash_key == NULL) && (config.key_size == 0) )
+    {
+        error_set(_error, 1);
+        return NULL;
+    }
+
+    if ( (_comp_key == NULL) && (config.key_size == 0) )
+    {
+        error_set(_error, 2);
+        return NULL;
+    }
+    if (_comp_data == NULL)
+    {
+        error_set(_error, 3);
+        return NULL;
+    }
+
+    // Корзина вмещает несколько цепочек, поэтому их загруженность может быть больше.
+    const float max_load_factor = (config.engine == C_HASH_MULTIMAP_ENGINE_BUCKETS) ?
+                                  (float)C_HASH_MULTIMAP_BUCKET_ENTRIES : C_HASH_MULTIMAP_MLF_MAX;
+    if ( (_max_load_factor < C_HASH_MULTIMAP_MLF_MIN) ||
+         (_max_load_factor > max_load_factor) )
+    {
+        error_set(_error, 4);
+        return NULL;
+    }
+
+    // Функции распределителя задаются либо обе, либо ни одной.
+    if ( (config.allocator.alloc == NULL) != (config.allocator.free == NULL) )
+    {
+        error_set(_error, 8);
+        return NULL;
+    }
+    if (config.allocator.alloc == NULL)
+    {
+        config.allocator.alloc = default_alloc;
+        config.allocator.free = default_free;
+        config.allocator.context = NULL;
+    }
+
+    if (config.pool_page_size == 0)
+    {
+        config.pool_page_size = C_HASH_MULTIMAP_POOL_PAGE;
+    }
+    // Строке нужно место хотя бы под завершающий нуль.
+    if ( (config.key_size > C_HASH_MULTIMAP_KEY_SIZE_MAX) ||
+         ( (config.key_string != 0) && (config.key_size == 0) ) )
+    {
+        error_set(_error, 17);
+        return NULL;
+    }
+
+    // На странице должен помещаться хотя бы один объект каждого пула.
+    if ( (config.pool_page_size < C_HASH_MULTIMAP_PAGE_HEADER + sizeof(c_hash_multimap_chain) +
+                                  config.key_size) ||
+         (config.pool_page_size < C_HASH_MULTIMAP_PAGE_HEADER +
+                                  C_HASH_MULTIMAP_VALUES_SIZE((size_t)1 << (C_HASH_MULTIMAP_VALUES_CLASSES - 1),
+                                                              config.hash_data != NULL)) )
+    {
+        error_set(_error, 9);
+        return NULL;
+    }
+
+    if ( (config.engine != C_HASH_MULTIMAP_ENGINE_CHAINED) &&
+         (config.engine != C_HASH_MULTIMAP_ENGINE_OPEN) &&
+         (config.engine != C_HASH_MULTIMAP_ENGINE_BUCKETS) )
+    {
+        error_set(_error, 10);
+        return NULL;
+    }
+
+    // Постепенное перестроение поддерживается только механизмом цепочек.
+    if ( (config.rehash_step != 0) && (config.engine != C_HASH_MULTIMAP_ENGINE_CHAINED) )
+    {
+        error_set(_error, 11);
+        return NULL;
+    }
+
+    // Между порогами расширения и уменьшения должен оставаться запас, иначе они будут чередоваться.
+    if ( (config.min_load_factor < 0.f) ||
+         (config.min_load_factor > _max_load_factor / 4) )
+    {
+        error_set(_error, 12);
+        return NULL;
+    }
+
+    // Одновременный доступ поддерживается только механизмами цепочек и корзин без постепенного перестроения.
+    if ( (config.lock_stripes != 0) &&
+         ( (config.engine == C_HASH_MULTIMAP_ENGINE_OPEN) || (config.rehash_step != 0) ) )
+    {
+        error_set(_error, 13);
+        return NULL;
+    }
+    // Полос не может быть больше, чем слотов у хэш-мультиотображения, расширенного с нуля.
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (config.lock_stripes > C_HASH_MULTIMAP_0)
+#else
+    if (config.lock_stripes != 0)
+#endif
+    {
+        error_set(_error, 14);
+        return NULL;
+    }
+    // Чтение без блокировок требует, чтобы писатели были разделены полосами.
+    if ( (config.lock_free_reads != 0) && (config.lock_stripes == 0) )
+    {
+        error_set(_error, 15);
+        return NULL;
+    }
+
+    c_hash_multimap *const new_hash_multimap = config.allocator.alloc(config.allocator.context,
+                                                                      sizeof(c_hash_multimap));
+    if (new_hash_multimap == NULL)
+    {
+        error_set(_error, 7);
+        return NULL;
+    }
+
+    new_hash_multimap->hash_key = _hash_key;
+    new_hash_multimap->comp_key = _comp_key;
+    new_hash_multimap->comp_data = _comp_data;
+    new_hash_multimap->hash_data = config.hash_data;
+    new_hash_multimap->data_index_capacity = SIZE_MAX;
+    if (config.hash_data != NULL)
+    {
+        new_hash_multimap->data_index_capacity = (config.data_index_capacity < C_HASH_MULTIMAP_DATA_INDEX_MIN) ?
+                                                 C_HASH_MULTIMAP_DATA_INDEX_MIN : config.data_index_capacity;
+    }
+
+    new_hash_multimap->slots_count = 0;
+    new_hash_multimap->chains_count = 0;
+    new_hash_multimap->nodes_count = 0;
+
+
+    new_hash_multimap->max_load_factor = _max_load_factor;
+    new_hash_multimap->min_load_factor = config.min_load_factor;
+
+    new_hash_multimap->pow2_slots = (config.pow2_slots != 0);
+    // Открытая адресация берет метку и начало последовательности проб из младших битов хэша,
+    // поэтому ее хэш перемешивается всегда.
+    new_hash_multimap->hash_finalizer = ( (config.hash_finalizer != 0) ||
+                                          (config.engine == C_HASH_MULTIMAP_ENGINE_OPEN) );
+
+    new_hash_multimap->key_size = config.key_size;
+    new_hash_multimap->key_string = (config.key_string != 0);
+
+    new_hash_multimap->engine = config.engine;
+    new_hash_multimap->slot_shift = 0;
+    if (config.engine == C_HASH_MULTIMAP_ENGINE_BUCKETS)
+    {
+        for (size_t p = C_HASH_MULTIMAP_CACHE_LINE / sizeof(c_hash_multimap_chain*); p > 1; p >>= 1)
+        {
+            ++new_hash_multimap->slot_shift;
+        }
+    }
+
+    new_hash_multimap->slots = NULL;
+    new_hash_multimap->ctrl = NULL;
+    new_hash_multimap->growth_left = 0;
+
+    new_hash_multimap->rehash_step = config.rehash_step;
+    new_hash_multimap->rehash_slots = NULL;
+    new_hash_multimap->rehash_slots_count = 0;
+    new_hash_multimap->rehash_index = 0;
+
+    new_hash_multimap->allocator = config.allocator;
+
+    // Ключи, хранящиеся внутри цепочек, располагаются сразу за ними.
+    pool_init(&new_hash_multimap->chains_pool, sizeof(c_hash_multimap_chain) + config.key_size,
+              config.pool_page_size);
+    for (size_t c = 0; c < C_HASH_MULTIMAP_VALUES_CLASSES; ++c)
+    {
+        pool_init(&new_hash_multimap->values_pools[c], values_size(new_hash_multimap, (size_t)1 << c),
+                  config.pool_page_size);
+    }
+    new_hash_multimap->values_large = 0;
+
+    new_hash_multimap->resizes_count = 0;
+#if defined(C_HASH_MULTIMAP_COUNTERS)
+    new_hash_multimap->lookups = 0;
+    new_hash_multimap->probes = 0;
+    new_hash_multimap->key_comparisons = 0;
+    new_hash_multimap->data_comparisons = 0;
+#endif
+
+    new_hash_multimap->values_hint_capacity = 1;
+    new_hash_multimap->values_hint_left = 0;
+
+    new_hash_multimap->stripes_count = 0;
+#if defined(C_HASH_MULTIMAP_THREADS)
+    new_hash_multimap->stripes = NULL;
+    new_hash_multimap->stripe_size = 0;
+    if (config.lock_stripes != 0)
+    {
+        // Полоса ключа выделяется из хэша маской, поэтому слоты всегда являются степенью двойки.
+        // Полоса и слот определяются младшими битами хэша, поэтому хэш всегда перемешивается:
+        // иначе у слабой функции хэша ключи скапливались бы в немногих слотах и одной полосе.
+        new_hash_multimap->pow2_slots = 1;
+        new_hash_multimap->hash_finalizer = 1;
+
+        const size_t stripes_count = pow2_round(config.lock_stripes);
+        // Каждая блокировка занимает целое число строк кэша.
+        const size_t stripe_size = (sizeof(pthread_rwlock_t) + C_HASH_MULTIMAP_CACHE_LINE - 1) /
+                                   C_HASH_MULTIMAP_CACHE_LINE * C_HASH_MULTIMAP_CACHE_LINE;
+        char *const new_stripes = config.allocator.alloc(config.allocator.context, stripes_count * stripe_size);
+        if (new_stripes == NULL)
+        {
+            config.allocator.free(config.allocator.context, new_hash_multimap, sizeof(c_hash_multimap));
+            error_set(_error, 7);
+            return NULL;
+        }
+        for (size_t s = 0; s < stripes_count; ++s)
+        {
+            pthread_rwlock_init((pthread_rwlock_t*)(new_stripes + s * stripe_size), NULL);
+        }
+        pthread_mutex_init(&new_hash_multimap->heap_lock, NULL);
+
+        new_hash_multimap->stripes = new_stripes;
+        new_hash_multimap->stripe_size = stripe_size;
+        new_hash_multimap->stripes_count = stripes_count;
+    }
+
+    new_hash_multimap->lock_free_reads = (config.lock_free_reads != 0);
+    new_hash_multimap->id = 0;
+    if (new_hash_multimap->lock_free_reads != 0)
+    {
+        new_hash_multimap->id = __atomic_add_fetch(&maps_count, 1, __ATOMIC_RELAXED);
+    }
+    new_hash_multimap->table = NULL;
+    new_hash_multimap->slots_seq = 0;
+    new_hash_multimap->epoch = 0;
+    new_hash_multimap->readers = NULL;
+    new_hash_multimap->retired = NULL;
+    new_hash_multimap->retired_count = 0;
+    pool_init(&new_hash_multimap->retired_pool, sizeof(c_hash_multimap_retired), config.pool_page_size);
+
+    new_hash_multimap->rebuild_parallel = config.rebuild_parallel;
+    new_hash_multimap->rebuild_executor = config.rebuild_executor;
+#endif
+
+    if (_slots_count > 0)
+    {
+        const size_t slots_count = slots_round(new_hash_multimap, _slots_count);
+        const ptrdiff_t r_code = (slots_count == 0) ? -1 : slots_rebuild(new_hash_multimap, slots_count);
+        if (r_code < 0)
+        {
+            // Неудачное перестроение не публикует слоты и не ампутирует объектов.
+            stripes_free(new_hash_multimap);
+            config.allocator.free(config.allocator.context, new_hash_multimap, sizeof(c_hash_multimap));
+            error_set(_error, (r_code == -1) ? 5 : 6);
+            return NULL;
+        }
+    }
+
+    return new_hash_multimap;
+}
+
+// Освобождает память очищенного хэш-мультиотображения и его самого.
+static void hash_multimap_free(c_hash_multimap *const _hash_multimap)
+{
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        // Читателей у удаляемого хэш-мультиотображения быть не может, поэтому ампутированные объекты
+        // освобождаются сразу, а пулы - после них.
+        retired_drain(_hash_multimap);
+        pool_release(_hash_multimap, &_hash_multimap->retired_pool);
+
+        c_hash_multimap_reader *select_reader = _hash_multimap->readers;
+        while (select_reader != NULL)
+        {
+            c_hash_multimap_reader *const delete_reader = select_reader;
+            select_reader = select_reader->next_reader;
+            memory_free(_hash_multimap, delete_reader, C_HASH_MULTIMAP_READER_SIZE);
+        }
+
+        // Опубликованные слоты освобождаются ниже как текущие.
+        if (_hash_multimap->table != NULL)
+        {
+            memory_free(_hash_multimap, _hash_multimap->table, sizeof(c_hash_multimap_table));
+        }
+    }
+#endif
+
+    // Пулы могут хранить страницы и у пустого хэш-мультиотображения.
+    pool_release(_hash_multimap, &_hash_multimap->chains_pool);
+    for (size_t c = 0; c < C_HASH_MULTIMAP_VALUES_CLASSES; ++c)
+    {
+        pool_release(_hash_multimap, &_hash_multimap->values_pools[c]);
+    }
+
+    slots_free(_hash_multimap, _hash_multimap->slots, _hash_multimap->ctrl, _hash_multimap->slots_count);
+    // Опустевшие старые слоты постепенного перестроения могут остаться и после очистки.
+    slots_free(_hash_multimap, _hash_multimap->rehash_slots, NULL, _hash_multimap->rehash_slots_count);
+
+    stripes_free(_hash_multimap);
+
+    const c_hash_multimap_allocator allocator = _hash_multimap->allocator;
+    allocator.free(allocator.context, _hash_multimap, sizeof(c_hash_multimap));
+}
+
+// Удаляет хэш-мультиотображение.
+// В случае успеха возвращает > 0, иначе < 0.
+ptrdiff_t c_hash_multimap_delete(c_hash_multimap *const _hash_multimap,
+                                 void (*const _del_key)(void *const _key),
+                                 void (*const _del_data)(void *const _data))
+{
+    if (c_hash_multimap_clear(_hash_multimap, _del_key, _del_data) < 0)
+    {
+        return -1;
+    }
+
+    hash_multimap_free(_hash_multimap);
+
+    return 1;
+}
+
+// Очищает хэш-мультиотображение ото всех элементов.
+// Если _job != NULL, цепочки удаляются параллельным обходом с функциями удаления задания,
+// а _del_key и _del_data не используются.
+// В случае успешного очищения возвращает > 0.
+// Если очищать не от чего, возвращает 0.
+static ptrdiff_t pairs_clear(c_hash_multimap *const _hash_multimap,
+                             void (*const _del_key)(void *const _key),
+                             void (*const _del_data)(void *const _data),
+                             c_hash_multimap_job *const _job)
+{
+    // Если очищать не от чего, то ничего не делаем.
+    if (_hash_multimap->chains_count == 0)
+    {
+        return 0;
+    }
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    // Слоты снимаются с публикации, и после завершения начатых чтений цепочки освобождаются
+    // без отсрочки, вместе с ранее ампутированными объектами, память которых принадлежит пулам.
+    c_hash_multimap_table *const table = _hash_multimap->table;
+    if (_hash_multimap->lock_free_reads != 0)
+    {
+        C_HASH_MULTIMAP_STORE(_hash_multimap->table, NULL);
+        readers_wait(_hash_multimap);
+        retired_drain(_hash_multimap);
+    }
+#endif
+
+    // Цепочки и массивы данных из пулов по одному не освобождаются, их память возвращается вместе
+    // со страницами пулов, поэтому обходить цепочки требуется только ради функций удаления
+    // и массивов, выделенных не из пулов.
+    if (_job != NULL)
+    {
+        if ( (_job->del_key != NULL) || (_job->del_data != NULL) || (_hash_multimap->values_large > 0) )
+        {
+            job_run(_job, job_task);
+            _hash_multimap->values_large -= _job->values_freed;
+        }
+    } else if ( (_del_key != NULL) || (_del_data != NULL) || (_hash_multimap->values_large > 0) )
+    {
+        size_t count = _hash_multimap->chains_count;
+        // Обходятся текущие слоты и старые слоты постепенного перестроения.
+        for (size_t t = 0; t < 2; ++t)
+        {
+            c_hash_multimap_chain *const *const slots = (t == 0) ? _hash_multimap->slots :
+                                                                   _hash_multimap->rehash_slots;
+            const size_t slots_count = (t == 0) ? _hash_multimap->slots_count :
+                                                  _hash_multimap->rehash_slots_count;
+            const uint64_t *const occupied = slots_occupied(_hash_multimap, slots, slots_count);
+            for (size_t s = slot_next(occupied, 0, slots_count);
+                 (s < slots_count)&&(count > 0);
+                 s = slot_next(occupied, s + 1, slots_count))
+            {
+                const c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, slots, s);
+                // Обойдем все цепочки слота.
+                while (select_chain != NULL)
+                {
+                    c_hash_multimap_values *const values = select_chain->values;
+
+                    if (_del_data != NULL)
+                    {
+                        for (size_t v = 0; v < values->count; ++v)
+                        {
+                            _del_data(values->datas[v]);
+                        }
+                    }
+                    if ( (_del_key != NULL) && (_hash_multimap->key_size == 0) )
+                    {
+                        _del_key(select_chain->key);
+                    }
+
+                    if (bit_lowest(values->capacity) >= C_HASH_MULTIMAP_VALUES_CLASSES)
+                    {
+                        values_free(_hash_multimap, values);
+                    }
+
+                    select_chain = select_chain->next_chain;
+                    --count;
+                }
+            }
+        }
+    }
+
+    if (_hash_multimap->min_load_factor > 0.f)
+    {
+        // При автоматическом уменьшении слоты опустевшего хэш-мультиотображения освобождаются полностью,
+        // следующая вставка выделит их заново.
+        slots_free(_hash_multimap, _hash_multimap->slots, _hash_multimap->ctrl, _hash_multimap->slots_count);
+        _hash_multimap->slots = NULL;
+        _hash_multimap->ctrl = NULL;
+        _hash_multimap->growth_left = 0;
+        _hash_multimap->slots_count = 0;
+    } else {
+        memset(_hash_multimap->slots, 0, slots_size(_hash_multimap, _hash_multimap->slots_count));
+        if (_hash_multimap->ctrl != NULL)
+        {
+            memset(_hash_multimap->ctrl, C_HASH_MULTIMAP_CTRL_EMPTY, _hash_multimap->slots_count);
+            _hash_multimap->growth_left = open_limit(_hash_multimap, _hash_multimap->slots_count);
+        }
+    }
+
+    // Незавершенное постепенное перестроение прекращается, переносить больше нечего.
+    slots_free(_hash_multimap, _hash_multimap->rehash_slots, NULL, _hash_multimap->rehash_slots_count);
+    _hash_multimap->rehash_slots = NULL;
+    _hash_multimap->rehash_slots_count = 0;
+    _hash_multimap->rehash_index = 0;
+
+    pool_release(_hash_multimap, &_hash_multimap->chains_pool);
+    for (size_t c = 0; c < C_HASH_MULTIMAP_VALUES_CLASSES; ++c)
+    {
+        pool_release(_hash_multimap, &_hash_multimap->values_pools[c]);
+    }
+
+    // Резерв пулов освобожден вместе с их страницами.
+    _hash_multimap->values_hint_left = 0;
+
+    _hash_multimap->chains_count = 0;
+    _hash_multimap->nodes_count = 0;
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (table != NULL)
+    {
+        // Сохраненные слоты публикуются снова уже пустыми.
+        if (_hash_multimap->slots_count != 0)
+        {
+            C_HASH_MULTIMAP_STORE(_hash_multimap->table, table);
+        } else {
+            heap_lock(_hash_multimap);
+            memory_free(_hash_multimap, table, sizeof(c_hash_multimap_table));
+            heap_unlock(_hash_multimap);
+        }
+    }
+#endif
+
+    return 1;
+}
+
+// Очищает хэш-мультиотображение ото всех элементов.
+// Если min_load_factor равен 0, количество слотов сохраняется, иначе слоты освобождаются полностью
+// (количество слотов становится равным 0), и следующая вставка выделит их заново.
+// В случае успешного очищения возвращает > 0.
+// Если очищать не от чего, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_clear(c_hash_multimap *const _hash_multimap,
+                                void (*const _del_key)(void *const _key),
+                                void (*const _del_data)(void *const _data))
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+    const ptrdiff_t r_code = pairs_clear(_hash_multimap, _del_key, _del_data, NULL);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Очищает хэш-мультиотображение ото всех элементов, вызывая функции удаления параллельно
+// на нескольких исполнителях (см. c_hash_multimap_executor).
+// Слоты сохраняются или освобождаются так же, как при c_hash_multimap_clear(): если min_load_factor
+// равен 0, количество слотов сохраняется, иначе слоты освобождаются полностью.
+// Функции удаления получают _context и номер исполнителя и могут вызываться одновременно
+// из разных потоков для разных ключей и данных.
+// Коды возврата совпадают с c_hash_multimap_clear().
+ptrdiff_t c_hash_multimap_clear_parallel(c_hash_multimap *const _hash_multimap,
+                                         void (*const _del_key)(void *const _key,
+                                                                void *const _context,
+                                                                const size_t _worker),
+                                         void (*const _del_data)(void *const _data,
+                                                                 void *const _context,
+                                                                 const size_t _worker),
+                                         void *const _context,
+                                         const c_hash_multimap_executor *const _executor)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    c_hash_multimap_job job;
+    job_init(&job, _hash_multimap, _context, _executor);
+    job.del_key = _del_key;
+    job.del_data = _del_data;
+
+    stripes_lock(_hash_multimap, 1);
+    const ptrdiff_t r_code = pairs_clear(_hash_multimap, NULL, NULL, &job);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Удаляет хэш-мультиотображение, вызывая функции удаления параллельно, как
+// c_hash_multimap_clear_parallel().
+// В случае успеха возвращает > 0, иначе < 0.
+ptrdiff_t c_hash_multimap_delete_parallel(c_hash_multimap *const _hash_multimap,
+                                          void (*const _del_key)(void *const _key,
+                                                                 void *const _context,
+                                                                 const size_t _worker),
+                                          void (*const _del_data)(void *const _data,
+                                                                  void *const _context,
+                                                                  const size_t _worker),
+                                          void *const _context,
+                                          const c_hash_multimap_executor *const _executor)
+{
+    if (c_hash_multimap_clear_parallel(_hash_multimap, _del_key, _del_data, _context, _executor) < 0)
+    {
+        return -1;
+    }
+
+    hash_multimap_free(_hash_multimap);
+
+    return 1;
+}
+
+// Задает хэш-мультиотображению новое количество слотов, коды возврата совпадают
+// с c_hash_multimap_resize().
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+static ptrdiff_t slots_resize(c_hash_multimap *const _hash_multimap,
+                              const size_t _slots_count)
+{
+    // Незавершенное постепенное перестроение доводится до конца.
+    rehash_advance(_hash_multimap, SIZE_MAX);
+
+    // Приводим количество слотов к допустимому для механизма хранения.
+    const size_t slots_count = slots_round(_hash_multimap, _slots_count);
+    if ( (slots_count == 0) && (_slots_count != 0) )
+    {
+        return -3;
+    }
+
+    if (slots_count == _hash_multimap->slots_count)
+    {
+        return 0;
+    }
+
+    // Если задано нулевое число слотов.
+    if (slots_count == 0)
+    {
+        // А в хэш-мультиотображении имеются узлы.
+        if (_hash_multimap->nodes_count != 0)
+        {
+            return -2;
+        }
+
+        // Иначе все ок.
+#if defined(C_HASH_MULTIMAP_THREADS)
+        if (_hash_multimap->lock_free_reads != 0)
+        {
+            // Слоты освобождаются вместе с описанием, когда их не просматривает ни один читатель.
+            _hash_multimap->slots = NULL;
+            _hash_multimap->slots_count = 0;
+            table_publish(_hash_multimap, NULL);
+
+            return 1;
+        }
+#endif
+        slots_free(_hash_multimap, _hash_multimap->slots, _hash_multimap->ctrl, _hash_multimap->slots_count);
+        _hash_multimap->slots = NULL;
+        _hash_multimap->ctrl = NULL;
+        _hash_multimap->growth_left = 0;
+
+        _hash_multimap->slots_count = 0;
+
+        return 1;
+    } else {
+        // Если задано ненулевое число слотов.
+
+        // Таблица открытой адресации должна вмещать все цепочки.
+        if ( (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN) &&
+             (open_limit(_hash_multimap, slots_count) < _hash_multimap->chains_count) )
+        {
+            return -5;
+        }
+
+        // Переносим цепочки в новые слоты.
+        const ptrdiff_t r_code = slots_rebuild(_hash_multimap, slots_count);
+        if (r_code == -1)
+        {
+            return -3;
+        }
+        if (r_code < 0)
+        {
+            return -4;
+        }
+
+        return 2;
+    }
+}
+
+// Задает хэш-мультиотображению новое количество слотов.
+// Позволяет расширить хэш-мультиотображение с нулем слотов.
+// Если количество слотов должно быть степенью двойки, заданное количество округляется вверх.
+// Если в хэш-мультиотображении есть хотя бы один узел (пара ключ-данные), то попытка задать нулевое количество слотов
+// считается ошибкой.
+// Для открытой адресации ошибкой также считается количество слотов, недостаточное для размещения
+// всех цепочек.
+// Незавершенное постепенное перестроение перед изменением количества слотов доводится до конца.
+// Если хэш-мультиотображение перестраивается функция возвращает > 0.
+// Если не перестраивается, функция возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_resize(c_hash_multimap *const _hash_multimap,
+                                 const size_t _slots_count)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+    const ptrdiff_t r_code = slots_resize(_hash_multimap, _slots_count);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Перестраивает таблицу открытой адресации, у которой закончились пустые слоты.
+// Если большую часть занятых слотов составляют надгробия, таблица перестраивается с прежним
+// количеством слотов, иначе количество слотов удваивается.
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t open_grow(c_hash_multimap *const _hash_multimap)
+{
+    size_t new_slots_count = _hash_multimap->slots_count;
+    if (_hash_multimap->chains_count >= open_limit(_hash_multimap, new_slots_count) / 2)
+    {
+        do
+        {
+            new_slots_count <<= 1;
+            if (new_slots_count == 0)
+            {
+                return -1;
+            }
+        } while (open_limit(_hash_multimap, new_slots_count) <= _hash_multimap->chains_count);
+    }
+
+    return slots_rebuild(_hash_multimap, new_slots_count);
+}
+
+// Продвигает постепенное перестроение: переносит в новые слоты цепочки не более чем _steps
+// непустых старых слотов.
+// Позволяет завершать перестроение в периоды простоя, не дожидаясь изменяющих операций.
+// Если после переноса перестроение еще выполняется, возвращает > 0.
+// Если перестроение завершено или не выполнялось, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_rehash(c_hash_multimap *const _hash_multimap,
+                                 const size_t _steps)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+    rehash_advance(_hash_multimap, _steps);
+    const ptrdiff_t result = (_hash_multimap->rehash_slots != NULL);
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Возвращает наименьшее допустимое для механизма хранения количество слотов, при котором
+// заданное ненулевое количество цепочек дает загруженность ниже заданной.
+// Для открытой адресации загруженность дополнительно ограничивается C_HASH_MULTIMAP_OPEN_MLF.
+// В случае переполнения возвращает 0.
+static size_t slots_fit(const c_hash_multimap *const _hash_multimap,
+                        const size_t _chains_count,
+                        float _load_factor)
+{
+    if ( (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN) &&
+         (_load_factor > C_HASH_MULTIMAP_OPEN_MLF) )
+    {
+        _load_factor = C_HASH_MULTIMAP_OPEN_MLF;
+    }
+
+    const double slots_count = (double)_chains_count / _load_factor + 1.;
+    if (slots_count >= (double)SIZE_MAX)
+    {
+        return 0;
+    }
+
+    return slots_round(_hash_multimap, (size_t)slots_count);
+}
+
+// Проверяет, опустилась ли загруженность ниже min_load_factor.
+// При одновременном доступе вызывающий должен удерживать блокировку хотя бы одной полосы.
+static size_t slots_shrink_needed(const c_hash_multimap *const _hash_multimap)
+{
+    if ( (_hash_multimap->min_load_factor == 0.f) ||
+         (_hash_multimap->slots_count <= C_HASH_MULTIMAP_0) )
+    {
+        return 0;
+    }
+
+    const float load_factor = (float)counter_load(_hash_multimap, &_hash_multimap->chains_count) /
+                              _hash_multimap->slots_count;
+    return (load_factor < _hash_multimap->min_load_factor);
+}
+
+// Если загруженность опустилась ниже min_load_factor, уменьшает количество слотов так, чтобы
+// загруженность стала равна половине max_load_factor, но не ниже C_HASH_MULTIMAP_0.
+// Если уменьшить слоты не удалось, продолжают использоваться прежние.
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+static void slots_shrink(c_hash_multimap *const _hash_multimap)
+{
+    if (slots_shrink_needed(_hash_multimap) == 0)
+    {
+        return;
+    }
+
+    size_t new_slots_count = slots_fit(_hash_multimap, _hash_multimap->chains_count,
+                                       _hash_multimap->max_load_factor / 2);
+    if (new_slots_count < C_HASH_MULTIMAP_0)
+    {
+        new_slots_count = slots_round(_hash_multimap, C_HASH_MULTIMAP_0);
+    }
+    if ( (new_slots_count == 0) || (new_slots_count >= _hash_multimap->slots_count) )
+    {
+        return;
+    }
+
+    if (_hash_multimap->rehash_step != 0)
+    {
+        // Незавершенное постепенное перестроение доводится до конца, после чего начинается новое.
+        rehash_advance(_hash_multimap, SIZE_MAX);
+        rehash_start(_hash_multimap, new_slots_count);
+    } else {
+        slots_resize(_hash_multimap, new_slots_count);
+    }
+}
+
+// Увеличивает количество слотов так, чтобы заданное ненулевое количество новых цепочек можно было
+// встроить без перестроения.
+// Если _grow != 0, слоты увеличиваются не менее чем так же, как при автоматическом расширении,
+// чтобы череда небольших увеличений не перестраивала таблицу каждый раз.
+// Если слотов достаточно, но таблицу открытой адресации занимают надгробия, она перестраивается
+// с прежним количеством слотов.
+// Незавершенное постепенное перестроение доводится до конца.
+// В случае успеха возвращает > 0.
+// В случае переполнения возвращает -1, в случае нехватки памяти возвращает -2.
+static ptrdiff_t slots_prepare(c_hash_multimap *const _hash_multimap,
+                               const size_t _chains_count,
+                               const size_t _grow)
+{
+    // Количество цепочек после встраивания.
+    const size_t chains_count = _hash_multimap->chains_count + _chains_count;
+    if (chains_count < _chains_count)
+    {
+        return -1;
+    }
+
+    size_t slots_count = slots_fit(_hash_multimap, chains_count, _hash_multimap->max_load_factor);
+    if (slots_count == 0)
+    {
+        return -1;
+    }
+
+    if (slots_count > _hash_multimap->slots_count)
+    {
+        if (_grow != 0)
+        {
+            // Степени двойки удваиваются, иное количество слотов увеличивается в 1.75 раза.
+            size_t grown_slots_count = _hash_multimap->slots_count << 1;
+            if ( (_hash_multimap->pow2_slots == 0) && (_hash_multimap->engine != C_HASH_MULTIMAP_ENGINE_OPEN) )
+            {
+                grown_slots_count = (size_t)(_hash_multimap->slots_count * 1.75f) + 1;
+            }
+            if ( (grown_slots_count > _hash_multimap->slots_count) && (grown_slots_count > slots_count) )
+            {
+                slots_count = grown_slots_count;
+            }
+        }
+
+        const ptrdiff_t r_code = slots_resize(_hash_multimap, slots_count);
+        if (r_code == -3)
+        {
+            return -1;
+        }
+        if (r_code < 0)
+        {
+            return -2;
+        }
+        return 1;
+    }
+
+    rehash_advance(_hash_multimap, SIZE_MAX);
+
+    if ( (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN) &&
+         (_hash_multimap->growth_left < _chains_count) )
+    {
+        return slots_rebuild(_hash_multimap, _hash_multimap->slots_count);
+    }
+
+    return 1;
+}
+
+// Резервирует слоты и пулы под заданное ненулевое количество новых уникальных ключей и пар,
+// коды возврата совпадают с c_hash_multimap_reserve().
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+static ptrdiff_t pairs_reserve(c_hash_multimap *const _hash_multimap,
+                               const size_t _unique_keys_count,
+                               const size_t _pairs_count)
+{
+    ptrdiff_t r_code = slots_prepare(_hash_multimap, _unique_keys_count, 0);
+    if (r_code == -1)
+    {
+        return -3;
+    }
+    if (r_code < 0)
+    {
+        return -4;
+    }
+
+    // Средняя вместимость массива данных нового ключа.
+    const size_t values_capacity = pow2_round((_pairs_count - 1) / _unique_keys_count + 1);
+    if (values_capacity == 0)
+    {
+        return -3;
+    }
+
+    r_code = pool_reserve(_hash_multimap, &_hash_multimap->chains_pool, _unique_keys_count);
+    const size_t values_class = bit_lowest(values_capacity);
+    if ( (r_code > 0) && (values_class < C_HASH_MULTIMAP_VALUES_CLASSES) )
+    {
+        r_code = pool_reserve(_hash_multimap, &_hash_multimap->values_pools[values_class], _unique_keys_count);
+    }
+    if (r_code == -1)
+    {
+        return -3;
+    }
+    if (r_code < 0)
+    {
+        return -4;
+    }
+
+    _hash_multimap->values_hint_capacity = values_capacity;
+    _hash_multimap->values_hint_left = _unique_keys_count;
+
+    return 1;
+}
+
+// Готовит хэш-мультиотображение к загрузке заданного количества новых уникальных ключей и пар.
+// Количество слотов увеличивается так, чтобы во время загрузки перестроение не потребовалось,
+// а память под цепочки и массивы данных новых ключей выделяется заранее одним блоком на пул.
+// Массивы данных новых ключей сразу получают вместимость, достаточную для среднего
+// количества данных на ключ.
+// Незавершенное постепенное перестроение доводится до конца.
+// Резерв пулов освобождается очисткой хэш-мультиотображения.
+// В случае успеха возвращает > 0.
+// Если резервировать нечего, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_reserve(c_hash_multimap *const _hash_multimap,
+                                  const size_t _unique_keys_count,
+                                  const size_t _pairs_count)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    // У каждого ключа есть хотя бы одни данные.
+    if (_pairs_count < _unique_keys_count)
+    {
+        return -2;
+    }
+    if (_unique_keys_count == 0)
+    {
+        return 0;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+    const ptrdiff_t r_code = pairs_reserve(_hash_multimap, _unique_keys_count, _pairs_count);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Уменьшает количество слотов до наименьшего, при котором загруженность остается ниже max_load_factor.
+// Хэш-мультиотображение без цепочек освобождает слоты полностью.
+// Незавершенное постепенное перестроение доводится до конца.
+// Если количество слотов уменьшено, возвращает > 0.
+// Если уменьшать не требуется, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_shrink_to_fit(c_hash_multimap *const _hash_multimap)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+
+    ptrdiff_t result = 0;
+
+    // Если цепочек нет, слоты освобождаются полностью.
+    size_t new_slots_count = 0;
+    if (_hash_multimap->chains_count > 0)
+    {
+        new_slots_count = slots_fit(_hash_multimap, _hash_multimap->chains_count,
+                                    _hash_multimap->max_load_factor);
+    }
+
+    if ( ( (new_slots_count != 0) || (_hash_multimap->chains_count == 0) ) &&
+         (new_slots_count < _hash_multimap->slots_count) )
+    {
+        result = (slots_resize(_hash_multimap, new_slots_count) < 0) ? -2 : 1;
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Вставляет пару с заданным неприведенным хэшем ключа.
+// Количество слотов должно быть ненулевым, для открытой адресации должно выполняться условие
+// growth_left > 0.
+// Если такого ключа не было, возвращает 1, если был, возвращает 2.
+// В случае ошибки возвращает < 0.
+static ptrdiff_t pair_insert(c_hash_multimap *const _hash_multimap,
+                             const void *const _key,
+                             const void *const _data,
+                             const size_t _k_hash)
+{
+    // Попытаемся найти цепочку, которая хранит аналогичный ключ.
+    c_hash_multimap_chain *const select_chain = chain_find(_hash_multimap, _key, _k_hash, NULL);
+
+    // Если такая цепочка есть, добавляем данные в ее массив.
+    if (select_chain != NULL)
+    {
+        if (chain_push(_hash_multimap, select_chain, _data) < 0)
+        {
+            return -10;
+        }
+
+        // Увеличиваем счетчик пар в хэш-мультиотображении.
+        counter_add(_hash_multimap, &_hash_multimap->nodes_count, 1);
+
+        return 2;
+    }
+
+    // Иначе создаем новую цепочку.
+
+    // Строка должна уместиться в цепочке вместе с завершающим нулем.
+    if ( (_hash_multimap->key_string != 0) &&
+         (memchr(_key, 0, _hash_multimap->key_size) == NULL) )
+    {
+        return -11;
+    }
+
+    // Пытаемся выделить память под цепочку.
+    // После резервирования массив данных цепочки сразу получает вместимость, рассчитанную
+    // на ожидаемое количество данных.
+    size_t values_capacity = 1;
+    heap_lock(_hash_multimap);
+    c_hash_multimap_chain *const new_chain = pool_alloc(_hash_multimap, &_hash_multimap->chains_pool);
+    if ( (new_chain != NULL) && (_hash_multimap->values_hint_left > 0) )
+    {
+        values_capacity = _hash_multimap->values_hint_capacity;
+        --_hash_multimap->values_hint_left;
+    }
+    heap_unlock(_hash_multimap);
+
+    // Если память выделить не удалось.
+    if (new_chain == NULL)
+    {
+        return -8;
+    }
+
+    // Пытаемся выделить память под массив данных.
+    c_hash_multimap_values *const new_values = values_alloc(_hash_multimap, values_capacity);
+    if (new_values == NULL)
+    {
+        heap_lock(_hash_multimap);
+        pool_free(&_hash_multimap->chains_pool, new_chain);
+        heap_unlock(_hash_multimap);
+        return -10;
+    }
+
+    // Цепочка захватывает ключ и данные.
+    // Ключ, хранящийся внутри цепочки, копируется, строка дополняется нулями до key_size.
+    if (_hash_multimap->key_size != 0)
+    {
+        new_chain->key = new_chain + 1;
+        if (_hash_multimap->key_string != 0)
+        {
+            strncpy(new_chain->key, _key, _hash_multimap->key_size);
+        } else {
+            memcpy(new_chain->key, _key, _hash_multimap->key_size);
+        }
+    } else {
+        new_chain->key = (void*)_key;
+    }
+    new_chain->k_hash = _k_hash;
+    new_chain->values = new_values;
+    values_set(_hash_multimap, new_values, 0, _data);
+    new_values->count = 1;
+    values_index_build(_hash_multimap, new_values);
+
+    // Интегрируем новую цепочку в слоты.
+    chain_attach(_hash_multimap, new_chain);
+
+    // Увеличиваем счетчики цепочек и пар в хэш-мультиотображении.
+    counter_add(_hash_multimap, &_hash_multimap->chains_count, 1);
+    counter_add(_hash_multimap, &_hash_multimap->nodes_count, 1);
+
+    return 1;
+}
+
+// Проверяет, требуется ли перед вставкой новой цепочки увеличить количество слотов.
+// При одновременном доступе вызывающий должен удерживать блокировку хотя бы одной полосы.
+static size_t slots_grow_needed(const c_hash_multimap *const _hash_multimap)
+{
+    if (_hash_multimap->slots_count == 0)
+    {
+        return 1;
+    }
+    if (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN)
+    {
+        return (_hash_multimap->growth_left == 0);
+    }
+
+    const float load_factor = (float)counter_load(_hash_multimap, &_hash_multimap->chains_count) /
+                              _hash_multimap->slots_count;
+    return (load_factor >= _hash_multimap->max_load_factor);
+}
+
+// Увеличивает количество слотов, если это требуется перед вставкой новой цепочки.
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+// В случае успеха возвращает > 0.
+// В случае ошибки возвращает код ошибки c_hash_multimap_insert() (< 0).
+static ptrdiff_t slots_grow(c_hash_multimap *const _hash_multimap)
+{
+    // Если слотов нет вообще.
+    if (_hash_multimap->slots_count == 0)
+    {
+        // Пытаемся расширить слоты.
+        if (slots_resize(_hash_multimap, C_HASH_MULTIMAP_0) <= 0)
+        {
+            return -4;
+        }
+    } else {
+        if (_hash_multimap->engine != C_HASH_MULTIMAP_ENGINE_OPEN)
+        {
+            // Если слоты есть, то при достижении предела загруженности увеличиваем количество слотов.
+            const float load_factor = (float)_hash_multimap->chains_count / _hash_multimap->slots_count;
+            if (load_factor >= _hash_multimap->max_load_factor)
+            {
+                // Определим новое количество слотов.
+                size_t new_slots_count;
+                if (_hash_multimap->pow2_slots != 0)
+                {
+                    new_slots_count = _hash_multimap->slots_count << 1;
+                    // Контролируем переполнение.
+                    if (new_slots_count < _hash_multimap->slots_count)
+                    {
+                        return -5;
+                    }
+                } else {
+                    new_slots_count = (size_t)(_hash_multimap->slots_count * 1.75f);
+                    // Контролируем переполнение.
+                    if (new_slots_count < _hash_multimap->slots_count)
+                    {
+                        return -5;
+                    }
+                    new_slots_count += 1;
+                    if (new_slots_count == 0)
+                    {
+                        return -6;
+                    }
+                }
+
+                // Пытаемся расширить слоты.
+                if (_hash_multimap->rehash_step != 0)
+                {
+                    // Незавершенное постепенное перестроение доводится до конца, после чего начинается новое.
+                    rehash_advance(_hash_multimap, SIZE_MAX);
+                    if (rehash_start(_hash_multimap, new_slots_count) < 0)
+                    {
+                        return -7;
+                    }
+                } else {
+                    if (slots_resize(_hash_multimap, new_slots_count) < 0)
+                    {
+                        return -7;
+                    }
+                }
+            }
+        }
+    }
+
+    // Для открытой адресации перестраиваем таблицу, если в ней не осталось пустых слотов.
+    if ( (_hash_multimap->engine == C_HASH_MULTIMAP_ENGINE_OPEN) &&
+         (_hash_multimap->growth_left == 0) )
+    {
+        const ptrdiff_t r_code = open_grow(_hash_multimap);
+        if (r_code == -1)
+        {
+            return -5;
+        }
+        if (r_code < 0)
+        {
+            return -7;
+        }
+    }
+
+    return 1;
+}
+
+// Вставляет пару с ключом, имеющим заданный неприведенный хэш, расширяя слоты при необходимости.
+static ptrdiff_t pair_add(c_hash_multimap *const _hash_multimap,
+                          const void *const _key,
+                          const size_t _k_hash,
+                          const void *const _data)
+{
+    // Продвигаем постепенное перестроение, если оно выполняется.
+    rehash_advance(_hash_multimap, _hash_multimap->rehash_step);
+
+    // Первым делом контролируем процесс увеличения количества слотов.
+    // При одновременном доступе расширение требует блокировки всех полос, поэтому на это время
+    // полоса ключа освобождается. Пока она была свободна, слоты могли измениться снова,
+    // поэтому проверка повторяется.
+    stripe_lock(_hash_multimap, _k_hash, 1);
+    while (slots_grow_needed(_hash_multimap) != 0)
+    {
+        stripe_unlock(_hash_multimap, _k_hash);
+
+        stripes_lock(_hash_multimap, 1);
+        const ptrdiff_t r_code = slots_grow(_hash_multimap);
+        stripes_unlock(_hash_multimap);
+        if (r_code < 0)
+        {
+            return r_code;
+        }
+
+        stripe_lock(_hash_multimap, _k_hash, 1);
+    }
+
+    // Вставляем данные в хэш-мультимножество.
+    const ptrdiff_t r_code = pair_insert(_hash_multimap, _key, _data, _k_hash);
+
+    stripe_unlock(_hash_multimap, _k_hash);
+
+    return r_code;
+}
+
+// Вставляет в хэш-мультиотображение новый элемент (пара ключ-значение).
+// Ключ хранится один раз на все связанные с ним данные.
+// Если такого ключа в хэш-мультиотображении не было, возвращает 1, ключ и данные захватываются
+// хэш-мультиотображением.
+// Если такой ключ уже есть, возвращает 2, захватываются только данные, а заданный ключ остается
+// во владении вызывающего.
+// Ключ, хранящийся внутри цепочек, копируется, поэтому заданный ключ всегда остается во владении
+// вызывающего. Если такой ключ является строкой не короче key_size, возвращает -11.
+// В случае ошибки возвращает < 0, ключ и данные не захватываются хэш-мультиотображением.
+ptrdiff_t c_hash_multimap_insert(c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 const void *const _data)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    return pair_add(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _data);
+}
+
+// Пакетная вставка в хэш-мультиотображение _count пар: _keys[i] - _datas[i].
+// Перед вставкой количество слотов один раз увеличивается так, чтобы встроить все пары без
+// перестроения, даже если все ключи окажутся новыми. Затем пары обрабатываются проходами
+// по C_HASH_MULTIMAP_BATCH: сначала вычисляются хэши всех ключей прохода, после чего пары
+// встраиваются по очереди, а слоты и цепочки следующих пар заранее подкачиваются в кэш.
+// Если _results != NULL, в _results[i] помещается результат вставки i-й пары, как его
+// вернула бы c_hash_multimap_insert(): 1 - новый ключ, 2 - существующий ключ, < 0 - ошибка.
+// Пары с ключом или данными, равными NULL, пропускаются с результатом -2 или -3.
+// Если вставлены все пары, возвращает > 0.
+// Если _count == 0, возвращает 0.
+// Если некоторые пары вставить не удалось, возвращает -6, остальные пары остаются вставленными.
+// В случае иной ошибки возвращает < 0, ни одна пара не вставляется.
+ptrdiff_t c_hash_multimap_insert_batch(c_hash_multimap *const _hash_multimap,
+                                       const void *const *const _keys,
+                                       const void *const *const _datas,
+                                       const size_t _count,
+                                       ptrdiff_t *const _results)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_count == 0)
+    {
+        return 0;
+    }
+    if (_keys == NULL)
+    {
+        return -2;
+    }
+    if (_datas == NULL)
+    {
+        return -3;
+    }
+
+    // Пары пакета попадают в разные полосы, поэтому на время вставки блокируются все.
+    stripes_lock(_hash_multimap, 1);
+
+    // Единожды готовим слоты ко всем парам пакета.
+    const ptrdiff_t r_code = slots_prepare(_hash_multimap, _count, 1);
+    if (r_code < 0)
+    {
+        stripes_unlock(_hash_multimap);
+        return (r_code == -1) ? -4 : -5;
+    }
+
+    ptrdiff_t result = 1;
+
+    size_t k_hashes[C_HASH_MULTIMAP_BATCH];
+    for (size_t b = 0; b < _count; b += C_HASH_MULTIMAP_BATCH)
+    {
+        const size_t batch_count = (_count - b < C_HASH_MULTIMAP_BATCH) ? _count - b : C_HASH_MULTIMAP_BATCH;
+        const void *const *const keys = _keys + b;
+        const void *const *const datas = _datas + b;
+
+        // Вычисляем хэши всех ключей прохода.
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            k_hashes[i] = (keys[i] != NULL) ? hash_compute(_hash_multimap, keys[i]) : 0;
+        }
+        for (size_t i = 0; (i < batch_count)&&(i < C_HASH_MULTIMAP_PREFETCH_DISTANCE); ++i)
+        {
+            slot_prefetch(_hash_multimap, k_hashes[i]);
+        }
+
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            // Подкачиваем слот далекой пары и цепочку близкой, слот которой уже подкачан.
+            if (i + C_HASH_MULTIMAP_PREFETCH_DISTANCE < batch_count)
+            {
+                slot_prefetch(_hash_multimap, k_hashes[i + C_HASH_MULTIMAP_PREFETCH_DISTANCE]);
+            }
+            if (i + C_HASH_MULTIMAP_PREFETCH_DISTANCE / 2 < batch_count)
+            {
+                chain_prefetch(_hash_multimap, k_hashes[i + C_HASH_MULTIMAP_PREFETCH_DISTANCE / 2]);
+            }
+
+            ptrdiff_t i_result;
+            if (keys[i] == NULL)
+            {
+                i_result = -2;
+            } else {
+                if (datas[i] == NULL)
+                {
+                    i_result = -3;
+                } else {
+                    i_result = pair_insert(_hash_multimap, keys[i], datas[i], k_hashes[i]);
+                }
+            }
+
+            if (i_result < 0)
+            {
+                result = -6;
+            }
+            if (_results != NULL)
+            {
+                _results[b + i] = i_result;
+            }
+        }
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Удаляет пару с ключом, имеющим заданный неприведенный хэш.
+static ptrdiff_t pair_erase(c_hash_multimap *const _hash_multimap,
+                            const void *const _key,
+                            const size_t _k_hash,
+                            const void *const _data,
+                            void (*const _del_key)(void *const _key),
+                            void (*const _del_data)(void *const _data))
+{
+    // Продвигаем постепенное перестроение, если оно выполняется.
+    rehash_advance(_hash_multimap, _hash_multimap->rehash_step);
+
+    stripe_lock(_hash_multimap, _k_hash, 1);
+
+    ptrdiff_t result = 0;
+    size_t shrink = 0;
+
+    if (counter_load(_hash_multimap, &_hash_multimap->nodes_count) > 0)
+    {
+        // Ищем цепочку, которая хранит заданный ключ.
+        c_hash_multimap_place place;
+        c_hash_multimap_chain *const select_chain = chain_find(_hash_multimap, _key, _k_hash, &place);
+        if (select_chain != NULL)
+        {
+            // Ищем такие данные среди данных цепочки.
+            c_hash_multimap_values *const values = select_chain->values;
+            size_t v;
+            if (values_find(_hash_multimap, values, values->count, _data, 0, &v) > 0)
+            {
+                // Нашли требуемые данные.
+                void *const delete_data = values->datas[v];
+
+                if (values->count == 1)
+                {
+                    // Последние данные цепочки удаляются вместе с ней и ее ключом.
+
+                    // Ампутация из слотов.
+                    chain_detach(_hash_multimap, select_chain, &place);
+
+                    // Уменьшаем счетчики цепочек и пар хэш-мультиотображения.
+                    counter_sub(_hash_multimap, &_hash_multimap->chains_count, 1);
+                    counter_sub(_hash_multimap, &_hash_multimap->nodes_count, 1);
+
+                    // Вызываем функции удаления и возвращаем массив данных и цепочку в пулы.
+                    chain_release(_hash_multimap, select_chain, _del_key, _del_data);
+
+                    shrink = slots_shrink_needed(_hash_multimap);
+
+                    result = 1;
+                } else {
+                    // Ампутируем данные из массива цепочки.
+                    if (chain_remove(_hash_multimap, select_chain, v) < 0)
+                    {
+                        result = -4;
+                    } else {
+                        // Уменьшаем счетчик пар хэш-мультиотображения.
+                        counter_sub(_hash_multimap, &_hash_multimap->nodes_count, 1);
+
+                        // Если задана функция удаления для данных.
+                        data_release(_hash_multimap, delete_data, _del_data);
+
+                        result = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    stripe_unlock(_hash_multimap, _k_hash);
+
+    // Уменьшаем слоты, если хэш-мультиотображение стало слишком разреженным.
+    if (shrink != 0)
+    {
+        stripes_lock(_hash_multimap, 1);
+        slots_shrink(_hash_multimap);
+        stripes_unlock(_hash_multimap);
+    }
+
+    return result;
+}
+
+// Удаляет заданную пару из хэш-мультиотображения.
+// Функция удаления ключа вызывается, только если удаляется последняя пара с этим ключом.
+// При чтении без блокировок функции удаления вызываются отложенно, когда удаленные ключ и данные
+// уже не может просматривать ни один читатель, а удаление данных, после которого у ключа остаются
+// другие данные, выделяет память под копию массива данных и в случае ее нехватки возвращает -4.
+// В случае успещного удаления возвращает > 0.
+// Если такой пары нет, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_erase(c_hash_multimap *const _hash_multimap,
+                                const void *const _key,
+                                const void *const _data,
+                                void (*const _del_key)(void *const _key),
+                                void (*const _del_data)(void *const _data))
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    return pair_erase(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _data, _del_key, _del_data);
+}
+
+// Удаляет все пары с ключом, имеющим заданный неприведенный хэш.
+static size_t key_erase(c_hash_multimap *const _hash_multimap,
+                        const void *const _key,
+                        const size_t _k_hash,
+                        void (*const _del_key)(void *const _key),
+                        void (*const _del_data)(void *const _data))
+{
+    // Продвигаем постепенное перестроение, если оно выполняется.
+    rehash_advance(_hash_multimap, _hash_multimap->rehash_step);
+
+    stripe_lock(_hash_multimap, _k_hash, 1);
+
+    size_t count = 0,
+           shrink = 0;
+
+    // Ищем цепочку, которая хранит заданный ключ.
+    c_hash_multimap_place place;
+    c_hash_multimap_chain *const select_chain = (counter_load(_hash_multimap, &_hash_multimap->nodes_count) > 0) ?
+                                                chain_find(_hash_multimap, _key, _k_hash, &place) : NULL;
+    if (select_chain != NULL)
+    {
+        // Ампутируем цепочку.
+        chain_detach(_hash_multimap, select_chain, &place);
+        // Запоминаем количество удаленных пар.
+        count = select_chain->values->count;
+        // Уменьшаем счетчик цепочек хэш-мультиотображения.
+        counter_sub(_hash_multimap, &_hash_multimap->chains_count, 1);
+        // Уменьшаем счетчик пар хэш-мультиотображения на количество данных удаляемой цепочки.
+        counter_sub(_hash_multimap, &_hash_multimap->nodes_count, count);
+        // Вызываем функции удаления для всех данных и ключа и возвращаем массив данных и цепочку в пулы.
+        chain_release(_hash_multimap, select_chain, _del_key, _del_data);
+
+        shrink = slots_shrink_needed(_hash_multimap);
+    }
+
+    stripe_unlock(_hash_multimap, _k_hash);
+
+    // Уменьшаем слоты, если хэш-мультиотображение стало слишком разреженным.
+    if (shrink != 0)
+    {
+        stripes_lock(_hash_multimap, 1);
+        slots_shrink(_hash_multimap);
+        stripes_unlock(_hash_multimap);
+    }
+
+    return count;
+}
+
+// Удаляет из хэш-мультиотображения все пары с заданным ключом.
+// При чтении без блокировок функции удаления вызываются отложенно.
+// Возвращает количество удаленных пар.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Поскольку функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_erase_all(c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 void (*const _del_key)(void *const _key),
+                                 void (*const _del_data)(void *const _data),
+                                 size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+
+    return key_erase(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _del_key, _del_data);
+}
+
+// Обход всеъ пар хэш-мультиотображения и выполнение над ключами и данными пар заданных действий.
+// Должно быть задано действие хотя бы для ключа, или хотя бы для данных.
+// Ключи нельзя удалять и менять.
+// Данные нельзя удалять, но можно менять.
+// При одновременном доступе обход выполняется под блокировками всех полос на чтение, поэтому
+// действия не должны изменять хэш-мультиотображение.
+// В случае успеха возвращает > 0.
+// Если в хэш-мультиотображении нет пар, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_for_each(c_hash_multimap *const _hash_multimap,
+                                   void (*const _action_key)(const void *const _key),
+                                   void (*const _action_data)(void *const _data))
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    if ( (_action_key == NULL) && (_action_data == NULL) )
+    {
+        return -2;
+    }
+
+    stripes_lock(_hash_multimap, 0);
+
+    size_t count = counter_load(_hash_multimap, &_hash_multimap->chains_count);
+
+    // Макросы дублирования кода для избавления от проверок внутри циклов.
+
+    // Открытие циклов.
+    // Обходятся текущие слоты и старые слоты постепенного перестроения.
+    #define C_HASH_MULTIMAP_FOR_EACH_BEGIN\
+    for (size_t t = 0; t < 2; ++t)\
+    {\
+        c_hash_multimap_chain *const *const slots = (t == 0) ? _hash_multimap->slots :\
+                                                               _hash_multimap->rehash_slots;\
+        const size_t slots_count = (t == 0) ? _hash_multimap->slots_count :\
+                                              _hash_multimap->rehash_slots_count;\
+        const uint64_t *const occupied = slots_occupied(_hash_multimap, slots, slots_count);\
+        for (size_t s = slot_next(occupied, 0, slots_count);\
+             (s < slots_count)&&(count > 0);\
+             s = slot_next(occupied, s + 1, slots_count))\
+        {\
+            c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, slots, s);\
+            while (select_chain != NULL)\
+            {\
+                c_hash_multimap_values *const values = select_chain->values;\
+                for (size_t v = 0; v < values->count; ++v)\
+                {
+
+    // Закрытие циклов.
+    #define C_HASH_MULTIMAP_FOR_EACH_END\
+                }\
+                select_chain = select_chain->next_chain;\
+                --count;\
+            }\
+        }\
+    }
+
+    if ( (_action_key != NULL) && (_action_data != NULL) )
+    {
+        // Заданы оба действия.
+        C_HASH_MULTIMAP_FOR_EACH_BEGIN
+
+        _action_key(select_chain->key);
+        _action_data(values->datas[v]);
+
+        C_HASH_MULTIMAP_FOR_EACH_END
+    } else {
+        if (_action_key != NULL)
+        {
+            // Задано действие только для ключей.
+            C_HASH_MULTIMAP_FOR_EACH_BEGIN
+
+            _action_key(select_chain->key);
+
+            C_HASH_MULTIMAP_FOR_EACH_END
+        } else {
+            // Задано действие только для данных.
+            C_HASH_MULTIMAP_FOR_EACH_BEGIN
+
+            _action_data(values->datas[v]);
+
+            C_HASH_MULTIMAP_FOR_EACH_END
+        }
+    }
+
+    #undef C_HASH_MULTIMAP_FOR_EACH_BEGIN
+    #undef C_HASH_MULTIMAP_FOR_EACH_END
+
+    stripes_unlock(_hash_multimap);
+
+    return 1;
+}
+
+// Параллельный обход всех пар хэш-мультиотображения на нескольких исполнителях
+// (см. c_hash_multimap_executor) и выполнение над ключами и данными пар заданных действий.
+// Слоты делятся на диапазоны, которые исполнители обрабатывают независимо, поэтому действия
+// вызываются одновременно из разных потоков и в произвольном порядке.
+// Действия получают _context и номер исполнителя (от 0 до количества исполнителей - 1),
+// по которому, например, можно выбрать собственный аккумулятор без синхронизации.
+// Ограничения на действия совпадают с c_hash_multimap_for_each().
+// В случае успеха возвращает > 0.
+// Если в хэш-мультиотображении нет пар, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_for_each_parallel(c_hash_multimap *const _hash_multimap,
+                                            void (*const _action_key)(const void *const _key,
+                                                                      void *const _context,
+                                                                      const size_t _worker),
+                                            void (*const _action_data)(void *const _data,
+                                                                       void *const _context,
+                                                                       const size_t _worker),
+                                            void *const _context,
+                                            const c_hash_multimap_executor *const _executor)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+
+    if ( (_action_key == NULL) && (_action_data == NULL) )
+    {
+        return -2;
+    }
+
+    c_hash_multimap_job job;
+    job_init(&job, _hash_multimap, _context, _executor);
+    job.action_key = _action_key;
+    job.action_data = _action_data;
+
+    stripes_lock(_hash_multimap, 0);
+
+    ptrdiff_t result = 0;
+    if (counter_load(_hash_multimap, &_hash_multimap->chains_count) > 0)
+    {
+        job_run(&job, job_task);
+        result = 1;
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Обход всех пар хэш-мультиотображения с выполнением над ключом и данными каждой пары заданного
+// действия, которое получает _context и может прервать обход, вернув не 0.
+// Ограничения на действие совпадают с c_hash_multimap_for_each().
+// Если пройдены все пары, возвращает 1.
+// Если обход прерван действием, возвращает 2.
+// Если в хэш-мультиотображении нет пар, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_for_each_ex(c_hash_multimap *const _hash_multimap,
+                                      size_t (*const _action)(const void *const _key,
+                                                              void *const _data,
+                                                              void *const _context),
+                                      void *const _context)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_action == NULL)
+    {
+        return -2;
+    }
+
+    stripes_lock(_hash_multimap, 0);
+
+    size_t count = counter_load(_hash_multimap, &_hash_multimap->chains_count);
+
+    ptrdiff_t result = (count > 0) ? 1 : 0;
+
+    // Обходятся текущие слоты и старые слоты постепенного перестроения.
+    for (size_t t = 0; (t < 2)&&(count > 0); ++t)
+    {
+        c_hash_multimap_chain *const *const slots = (t == 0) ? _hash_multimap->slots :
+                                                               _hash_multimap->rehash_slots;
+        const size_t slots_count = (t == 0) ? _hash_multimap->slots_count :
+                                              _hash_multimap->rehash_slots_count;
+        const uint64_t *const occupied = slots_occupied(_hash_multimap, slots, slots_count);
+        for (size_t s = slot_next(occupied, 0, slots_count);
+             (s < slots_count)&&(count > 0);
+             s = slot_next(occupied, s + 1, slots_count))
+        {
+            const c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, slots, s);
+            while (select_chain != NULL)
+            {
+                const c_hash_multimap_values *const values = select_chain->values;
+                for (size_t v = 0; v < values->count; ++v)
+                {
+                    if (_action(select_chain->key, values->datas[v], _context) != 0)
+                    {
+                        result = 2;
+                        count = 0;
+                        break;
+                    }
+                }
+                if (count == 0)
+                {
+                    break;
+                }
+
+                select_chain = select_chain->next_chain;
+                --count;
+            }
+        }
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Начинает обход пар хэш-мультиотображения внешним итератором.
+// Пары выдаются c_hash_multimap_iterator_next(), по завершении обхода (в том числе досрочном)
+// необходимо вызвать c_hash_multimap_iterator_end().
+// При одновременном доступе итератор удерживает блокировки всех полос на чтение от начала
+// до завершения обхода, поэтому изменять хэш-мультиотображение до завершения обхода нельзя.
+// Если в хэш-мультиотображении есть пары, возвращает > 0.
+// Если пар нет, возвращает 0.
+// В случае ошибки возвращает < 0, завершать такой обход не нужно.
+ptrdiff_t c_hash_multimap_iterator_begin(c_hash_multimap *const _hash_multimap,
+                                         c_hash_multimap_iterator *const _iterator)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_iterator == NULL)
+    {
+        return -2;
+    }
+
+    stripes_lock(_hash_multimap, 0);
+
+    _iterator->hash_multimap = _hash_multimap;
+    _iterator->table = 0;
+    _iterator->slot = 0;
+    _iterator->chain = NULL;
+    _iterator->value = 0;
+    _iterator->count = counter_load(_hash_multimap, &_hash_multimap->chains_count);
+
+    return (_iterator->count > 0) ? 1 : 0;
+}
+
+// Переходит к следующей паре обхода и помещает ее ключ и данные в заданные расположения
+// (если они заданы).
+// Если пара есть, возвращает > 0.
+// Если пары пройдены все, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_iterator_next(c_hash_multimap_iterator *const _iterator,
+                                        const void **const _key,
+                                        void **const _data)
+{
+    if (_iterator == NULL)
+    {
+        return -1;
+    }
+    if (_iterator->hash_multimap == NULL)
+    {
+        return -2;
+    }
+
+    const c_hash_multimap *const hash_multimap = _iterator->hash_multimap;
+    const c_hash_multimap_chain *select_chain = _iterator->chain;
+
+    // Если данные цепочки пройдены, переходим к следующей цепочке слота.
+    if ( (select_chain != NULL) && (_iterator->value == select_chain->values->count) )
+    {
+        select_chain = select_chain->next_chain;
+        _iterator->value = 0;
+        --_iterator->count;
+    }
+
+    // Ищем следующий непустой слот в текущих слотах, а затем в старых слотах постепенного перестроения.
+    while (select_chain == NULL)
+    {
+        if (_iterator->count == 0)
+        {
+            _iterator->chain = NULL;
+            return 0;
+        }
+
+        c_hash_multimap_chain *const *const slots = (_iterator->table == 0) ? hash_multimap->slots :
+                                                                               hash_multimap->rehash_slots;
+        const size_t slots_count = (_iterator->table == 0) ? hash_multimap->slots_count :
+                                                             hash_multimap->rehash_slots_count;
+        const size_t slot = slot_next(slots_occupied(hash_multimap, slots, slots_count),
+                                      _iterator->slot, slots_count);
+        if (slot == slots_count)
+        {
+            if (_iterator->table != 0)
+            {
+                _iterator->count = 0;
+                continue;
+            }
+            _iterator->table = 1;
+            _iterator->slot = 0;
+            continue;
+        }
+
+        select_chain = *slot_list(hash_multimap, slots, slot);
+        _iterator->slot = slot + 1;
+    }
+
+    _iterator->chain = select_chain;
+
+    if (_key != NULL)
+    {
+        *_key = select_chain->key;
+    }
+    if (_data != NULL)
+    {
+        *_data = select_chain->values->datas[_iterator->value];
+    }
+    ++_iterator->value;
+
+    return 1;
+}
+
+// Завершает обход, начатый c_hash_multimap_iterator_begin().
+// В случае успеха возвращает > 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_iterator_end(c_hash_multimap_iterator *const _iterator)
+{
+    if (_iterator == NULL)
+    {
+        return -1;
+    }
+    if (_iterator->hash_multimap == NULL)
+    {
+        return -2;
+    }
+
+    stripes_unlock(_iterator->hash_multimap);
+
+    _iterator->hash_multimap = NULL;
+    _iterator->chain = NULL;
+
+    return 1;
+}
+
+// Проверяет наличие ключа с заданным неприведенным хэшем.
+static ptrdiff_t key_check(const c_hash_multimap *const _hash_multimap,
+                           const void *const _key,
+                           const size_t _k_hash)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    ptrdiff_t result = 0;
+    if (chain_read(_hash_multimap, _key, _k_hash) != NULL)
+    {
+        result = 1;
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return result;
+}
+
+// Проверяет, есть ли такой ключ в хэш-мультиотображении.
+// Если есть, возвращает > 0.
+// Если нет, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_key_check(const c_hash_multimap *const _hash_multimap,
+                                    const void *const _key)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+
+    return key_check(_hash_multimap, _key, hash_compute(_hash_multimap, _key));
+}
+
+// Возвращает количество пар с ключом, имеющим заданный неприведенный хэш.
+static size_t key_count(const c_hash_multimap *const _hash_multimap,
+                        const void *const _key,
+                        const size_t _k_hash)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    size_t count = 0;
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, _k_hash);
+    if (select_chain != NULL)
+    {
+        count = C_HASH_MULTIMAP_LOAD(C_HASH_MULTIMAP_LOAD(select_chain->values)->count);
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return count;
+}
+
+// Возвращает количество пар с заданным ключом в хэш-мультиотображении.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_key_count(const c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+
+    return key_count(_hash_multimap, _key, hash_compute(_hash_multimap, _key));
+}
+
+// Проверяет наличие пары с ключом, имеющим заданный неприведенный хэш.
+static ptrdiff_t pair_check(const c_hash_multimap *const _hash_multimap,
+                            const void *const _key,
+                            const size_t _k_hash,
+                            const void *const _data)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    ptrdiff_t result = 0;
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, _k_hash);
+    if (select_chain != NULL)
+    {
+        const c_hash_multimap_values *const values = C_HASH_MULTIMAP_LOAD(select_chain->values);
+        const size_t values_count = C_HASH_MULTIMAP_LOAD(values->count);
+        result = (values_find(_hash_multimap, values, values_count, _data, 0, NULL) > 0);
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return result;
+}
+
+// Проверка наличия заданной пары в хэш-мультиотображении.
+// В случае наличия пары возвращает > 0.
+// В случае отсутствия пары возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_pair_check(const c_hash_multimap *const _hash_multimap,
+                                     const void *const _key,
+                                     const void *const _data)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    return pair_check(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _data);
+}
+
+// Возвращает количество пар с ключом, имеющим заданный неприведенный хэш, и заданными данными.
+static size_t pair_count(const c_hash_multimap *const _hash_multimap,
+                         const void *const _key,
+                         const size_t _k_hash,
+                         const void *const _data)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    size_t count = 0;
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, _k_hash);
+    if (select_chain != NULL)
+    {
+        const c_hash_multimap_values *const values = C_HASH_MULTIMAP_LOAD(select_chain->values);
+        const size_t values_count = C_HASH_MULTIMAP_LOAD(values->count);
+        count = values_find(_hash_multimap, values, values_count, _data, 1, NULL);
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return count;
+}
+
+// Возвращает количество пар с заданным ключем и данными.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки(> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_pair_count(const c_hash_multimap *const _hash_multimap,
+                                  const void *const _key,
+                                  const void *const _data,
+                                  size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+    if (_data == NULL)
+    {
+        error_set(_error, 3);
+        return 0;
+    }
+
+    return pair_count(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _data);
+}
+
+// Возвращает массив данных ключа с заданным неприведенным хэшем.
+static void** key_datas(c_hash_multimap *const _hash_multimap,
+                        const void *const _key,
+                        const size_t _k_hash,
+                        size_t *const _error)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    void **new_datas = NULL;
+
+    // Ищем цепочку, которая хранит заданный ключ.
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, _k_hash);
+
+    // Если есть цепочка, которая хранит заданный ключ.
+    if (select_chain != NULL)
+    {
+        const c_hash_multimap_values *const values = C_HASH_MULTIMAP_LOAD(select_chain->values);
+        const size_t values_count = C_HASH_MULTIMAP_LOAD(values->count);
+        // Определяем, сколько в массиве должно быть указателей.
+        const size_t datas_count = values_count + 1;
+        // Определяем размер массива
+        const size_t datas_size = datas_count * sizeof(void*);
+        // Контролируем переполнение.
+        if (datas_count == 0)// Не, ну а вдруг...)
+        {
+            error_set(_error, 3);
+        } else if ( (datas_size == 0) ||
+                    (datas_size / datas_count != sizeof(void*)) )
+        {
+            error_set(_error, 4);
+        } else {
+            // Пытаемся выделить память.
+            new_datas = malloc(datas_size);
+            // Контролируем успешность выделения памяти,
+            if (new_datas == NULL)
+            {
+                error_set(_error, 5);
+            } else {
+                // Заполняем.
+                memcpy(new_datas, values->datas, values_count * sizeof(void*));
+                // Ставим в конце массива отметку.
+                new_datas[values_count] = NULL;
+            }
+        }
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return new_datas;
+}
+
+// Возвращает массив с указателями на все данные, связанные с заданным ключом.
+// Массив "нультерминирован", последним указателем является NULL.
+// Если в хэш-мультиотображении нет пар с заданным ключом, функция возвращает NULL.
+// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать NULL и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+// Возвращаемый массив необходимо удалять при помощи free().
+void** c_hash_multimap_datas(c_hash_multimap *const _hash_multimap,
+                             const void *const _key,
+                             size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return NULL;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return NULL;
+    }
+
+    return key_datas(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _error);
+}
+
+// Заполняет представление всех данных, связанных с заданным ключом, без выделения памяти.
+// Представление действительно до первого изменения хэш-мультиотображения.
+// Если ключ есть, возвращает > 0.
+// Если ключа нет, возвращает 0, а представление становится пустым.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_datas_view(const c_hash_multimap *const _hash_multimap,
+                                     const void *const _key,
+                                     c_hash_multimap_view *const _view)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_view == NULL)
+    {
+        return -3;
+    }
+
+    _view->datas = NULL;
+    _view->count = 0;
+
+    // Неприведенный хэш ключа.
+    const size_t k_hash = hash_compute(_hash_multimap, _key);
+
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, k_hash);
+
+    ptrdiff_t result = 0;
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, k_hash);
+    if (select_chain != NULL)
+    {
+        const c_hash_multimap_values *const values = C_HASH_MULTIMAP_LOAD(select_chain->values);
+        _view->count = C_HASH_MULTIMAP_LOAD(values->count);
+        _view->datas = values->datas;
+        result = 1;
+    }
+
+    read_end(_hash_multimap, k_hash, reader);
+
+    return result;
+}
+
+// Копирует в буфер данные ключа с заданным неприведенным хэшем.
+static size_t key_fill(const c_hash_multimap *const _hash_multimap,
+                       const void *const _key,
+                       const size_t _k_hash,
+                       void **const _buffer,
+                       const size_t _capacity)
+{
+    c_hash_multimap_reader *const reader = read_begin(_hash_multimap, _k_hash);
+
+    size_t count = 0;
+    const c_hash_multimap_chain *const select_chain = chain_read(_hash_multimap, _key, _k_hash);
+    if (select_chain != NULL)
+    {
+        const c_hash_multimap_values *const values = C_HASH_MULTIMAP_LOAD(select_chain->values);
+        count = C_HASH_MULTIMAP_LOAD(values->count);
+        if (count > _capacity)
+        {
+            count = _capacity;
+        }
+        if (count > 0)
+        {
+            memcpy(_buffer, values->datas, count * sizeof(void*));
+        }
+    }
+
+    read_end(_hash_multimap, _k_hash, reader);
+
+    return count;
+}
+
+// Копирует в заданный буфер указатели на данные, связанные с заданным ключом, но не более _capacity.
+// Возвращает количество скопированных указателей.
+// Если данных больше, чем помещается в буфер, узнать их полное количество можно
+// при помощи c_hash_multimap_key_count().
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_datas_fill(const c_hash_multimap *const _hash_multimap,
+                                  const void *const _key,
+                                  void **const _buffer,
+                                  const size_t _capacity,
+                                  size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+    if ( (_buffer == NULL) && (_capacity > 0) )
+    {
+        error_set(_error, 3);
+        return 0;
+    }
+
+    return key_fill(_hash_multimap, _key, hash_compute(_hash_multimap, _key), _buffer, _capacity);
+}
+
+// Пакетный поиск _count ключей.
+// В _views[i] помещается представление всех данных, связанных с ключом _keys[i], как его заполнила бы
+// c_hash_multimap_datas_view(): если ключа нет, представление пустое. Наличие ключа и количество
+// его данных определяются по представлению, поэтому функция заменяет пакетные
+// c_hash_multimap_key_check(), c_hash_multimap_key_count() и c_hash_multimap_datas().
+// Ключи обрабатываются проходами по C_HASH_MULTIMAP_BATCH с поэтапной подкачкой: сначала вычисляются
+// хэши всех ключей прохода, затем подкачиваются их слоты, затем первые цепочки, затем ключи
+// и массивы данных этих цепочек, и только после этого выполняется поиск. Так промахи кэша
+// разных ключей перекрываются, а не выстраиваются в цепочку зависимых обращений.
+// Представления действительны до первого изменения хэш-мультиотображения.
+// Если _count == 0, возвращает 0.
+// Если среди ключей есть NULL, их представления остаются пустыми, а функция возвращает -4.
+// Иначе в случае успеха возвращает > 0, в случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_find_batch(const c_hash_multimap *const _hash_multimap,
+                                     const void *const *const _keys,
+                                     const size_t _count,
+                                     c_hash_multimap_view *const _views)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_count == 0)
+    {
+        return 0;
+    }
+    if (_keys == NULL)
+    {
+        return -2;
+    }
+    if (_views == NULL)
+    {
+        return -3;
+    }
+
+    ptrdiff_t result = 1;
+
+    // Ключи пакета попадают в разные полосы, поэтому на время поиска блокируются все.
+    stripes_lock(_hash_multimap, 0);
+
+    size_t k_hashes[C_HASH_MULTIMAP_BATCH];
+    for (size_t b = 0; b < _count; b += C_HASH_MULTIMAP_BATCH)
+    {
+        const size_t batch_count = (_count - b < C_HASH_MULTIMAP_BATCH) ? _count - b : C_HASH_MULTIMAP_BATCH;
+        const void *const *const keys = _keys + b;
+        c_hash_multimap_view *const views = _views + b;
+
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            views[i].datas = NULL;
+            views[i].count = 0;
+        }
+
+        // В пустом хэш-мультиотображении искать нечего.
+        if (counter_load(_hash_multimap, &_hash_multimap->nodes_count) == 0)
+        {
+            for (size_t i = 0; i < batch_count; ++i)
+            {
+                if (keys[i] == NULL)
+                {
+                    result = -4;
+                }
+            }
+            continue;
+        }
+
+        // Этап 1: хэши и подкачка слотов.
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            if (keys[i] != NULL)
+            {
+                k_hashes[i] = hash_compute(_hash_multimap, keys[i]);
+                slot_prefetch(_hash_multimap, k_hashes[i]);
+            }
+        }
+        // Этап 2: подкачка первых цепочек.
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            if (keys[i] != NULL)
+            {
+                chain_prefetch(_hash_multimap, k_hashes[i]);
+            }
+        }
+        // Этап 3: подкачка ключей и массивов данных цепочек.
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            if (keys[i] != NULL)
+            {
+                values_prefetch(_hash_multimap, k_hashes[i]);
+            }
+        }
+        // Этап 4: поиск.
+        for (size_t i = 0; i < batch_count; ++i)
+        {
+            if (keys[i] == NULL)
+            {
+                result = -4;
+                continue;
+            }
+            const c_hash_multimap_chain *const select_chain = chain_find(_hash_multimap, keys[i],
+                                                                         k_hashes[i], NULL);
+            if (select_chain != NULL)
+            {
+                views[i].datas = select_chain->values->datas;
+                views[i].count = select_chain->values->count;
+            }
+        }
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Возвращает количество слотов хэш-мультиотображения.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функций необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_slots_count(const c_hash_multimap *const _hash_multimap,
+                                   size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    // Количество слотов изменяется только под блокировками всех полос.
+    stripe_lock(_hash_multimap, 0, 0);
+    const size_t slots_count = _hash_multimap->slots_count;
+    stripe_unlock(_hash_multimap, 0);
+
+    return slots_count;
+}
+
+// Возвращает количество цепочек в хэш-мультимножестве.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_unique_keys_count(const c_hash_multimap *const _hash_multimap,
+                                         size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    return counter_load(_hash_multimap, &_hash_multimap->chains_count);
+}
+
+// Возвращает количество узлов в хэш-мультимножестве.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданое расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_pairs_count(const c_hash_multimap *const _hash_multimap,
+                                   size_t *const _error)
+{
+    if (_hash_multimap == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    return counter_load(_hash_multimap, &_hash_multimap->nodes_count);
+}
+
+// Возвращает размер всех страниц пула (в байтах).
+static size_t pool_bytes(const c_hash_multimap_pool *const _pool)
+{
+    size_t bytes = 0;
+    for (const c_hash_multimap_page *page = _pool->pages; page != NULL; page = page->next_page)
+    {
+        bytes += page->size;
+    }
+    return bytes;
+}
+
+// Заполняет статистику хэш-мультиотображения: гистограмму количества цепочек в слотах,
+// распределение количества данных по ключам, занимаемую память, количество перестроений слотов
+// и счетчики поисков.
+// Процентиль количества данных точен до C_HASH_MULTIMAP_STATS_EXACT, выше он округляется вверх
+// до степени двойки без единицы, но не превышает максимум.
+// Статистика обходит все цепочки, поэтому требует времени, пропорционального их количеству.
+// При одновременном доступе обход выполняется под блокировками всех полос на чтение.
+// В случае успеха возвращает > 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_stats(c_hash_multimap *const _hash_multimap,
+                                c_hash_multimap_statistics *const _stats)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_stats == NULL)
+    {
+        return -2;
+    }
+
+    memset(_stats, 0, sizeof(c_hash_multimap_statistics));
+
+    // Количество ключей с заданным количеством данных: точное и по степеням двойки.
+    size_t values_exact[C_HASH_MULTIMAP_STATS_EXACT] = {0};
+    size_t values_pow2[sizeof(size_t) * 8] = {0};
+
+    stripes_lock(_hash_multimap, 0);
+
+    size_t count = counter_load(_hash_multimap, &_hash_multimap->chains_count);
+    _stats->unique_keys_count = count;
+    _stats->pairs_count = counter_load(_hash_multimap, &_hash_multimap->nodes_count);
+    _stats->resizes_count = _hash_multimap->resizes_count;
+
+    size_t values_large_bytes = 0;
+
+    // Обходятся текущие слоты и старые слоты постепенного перестроения.
+    for (size_t t = 0; t < 2; ++t)
+    {
+        c_hash_multimap_chain *const *const slots = (t == 0) ? _hash_multimap->slots :
+                                                               _hash_multimap->rehash_slots;
+        const size_t slots_count = (t == 0) ? _hash_multimap->slots_count :
+                                              _hash_multimap->rehash_slots_count;
+        if (slots == NULL)
+        {
+            continue;
+        }
+
+        _stats->slots_count += slots_count;
+        _stats->slots_bytes += slots_size(_hash_multimap, slots_count);
+        if (_hash_multimap->slot_shift != 0)
+        {
+            _stats->slots_bytes += C_HASH_MULTIMAP_CACHE_LINE;
+        }
+        if (_hash_multimap->ctrl != NULL)
+        {
+            _stats->slots_bytes += slots_count;
+        }
+
+        const uint64_t *const occupied = slots_occupied(_hash_multimap, slots, slots_count);
+        for (size_t s = slot_next(occupied, 0, slots_count);
+             (s < slots_count)&&(count > 0);
+             s = slot_next(occupied, s + 1, slots_count))
+        {
+            size_t chains = 0;
+            const c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, slots, s);
+            while (select_chain != NULL)
+            {
+                const c_hash_multimap_values *const values = select_chain->values;
+                if (values->count < C_HASH_MULTIMAP_STATS_EXACT)
+                {
+                    ++values_exact[values->count];
+                } else {
+                    size_t values_class = 0;
+                    for (size_t v = values->count; v > 1; v >>= 1)
+                    {
+                        ++values_class;
+                    }
+                    ++values_pow2[values_class];
+                }
+                if (values->count > _stats->max_values)
+                {
+                    _stats->max_values = values->count;
+                }
+                if (bit_lowest(values->capacity) >= C_HASH_MULTIMAP_VALUES_CLASSES)
+                {
+                    values_large_bytes += values_size(_hash_multimap, values->capacity);
+                }
+
+                ++chains;
+                select_chain = select_chain->next_chain;
+                --count;
+            }
+
+            ++_stats->occupied_slots;
+            ++_stats->chains_histogram[(chains < C_HASH_MULTIMAP_STATS_HISTOGRAM) ?
+                                       chains : C_HASH_MULTIMAP_STATS_HISTOGRAM - 1];
+            if (chains > _stats->max_chains)
+            {
+                _stats->max_chains = chains;
+            }
+        }
+    }
+    _stats->chains_histogram[0] = _stats->slots_count - _stats->occupied_slots;
+
+    heap_lock(_hash_multimap);
+    _stats->chains_bytes = pool_bytes(&_hash_multimap->chains_pool);
+    _stats->values_bytes = values_large_bytes;
+    for (size_t c = 0; c < C_HASH_MULTIMAP_VALUES_CLASSES; ++c)
+    {
+        _stats->values_bytes += pool_bytes(&_hash_multimap->values_pools[c]);
+    }
+    heap_unlock(_hash_multimap);
+
+#if defined(C_HASH_MULTIMAP_COUNTERS)
+    _stats->lookups = counter_load(_hash_multimap, &_hash_multimap->lookups);
+    _stats->probes = counter_load(_hash_multimap, &_hash_multimap->probes);
+    _stats->key_comparisons = counter_load(_hash_multimap, &_hash_multimap->key_comparisons);
+    _stats->data_comparisons = counter_load(_hash_multimap, &_hash_multimap->data_comparisons);
+#endif
+
+    stripes_unlock(_hash_multimap);
+
+    // 99-й процентиль: наименьшее количество данных, которого не превышают 99% ключей.
+    if (_stats->unique_keys_count > 0)
+    {
+        size_t rest = _stats->unique_keys_count - _stats->unique_keys_count / 100;
+        for (size_t v = 0; v < C_HASH_MULTIMAP_STATS_EXACT; ++v)
+        {
+            if (values_exact[v] >= rest)
+            {
+                _stats->p99_values = v;
+                rest = 0;
+                break;
+            }
+            rest -= values_exact[v];
+        }
+        for (size_t c = 0; (c < sizeof(size_t) * 8)&&(rest > 0); ++c)
+        {
+            if (values_pow2[c] >= rest)
+            {
+                const size_t bound = (c + 1 < sizeof(size_t) * 8) ? ((size_t)2 << c) - 1 : SIZE_MAX;
+                _stats->p99_values = (bound < _stats->max_values) ? bound : _stats->max_values;
+                break;
+            }
+            rest -= values_pow2[c];
+        }
+    }
+
+    return 1;
+}
+
+// Заполняет сигнатуру файла заданного вида ("CHMM" или "CHMF").
+static void file_signature(uint8_t *const _signature,
+                           const char *const _magic)
+{
+    memcpy(_signature, _magic, 4);
+    _signature[4] = C_HASH_MULTIMAP_FILE_VERSION;
+    _signature[5] = (uint8_t)sizeof(size_t);
+    _signature[6] = 0;
+    _signature[7] = 0;
+}
+
+// Сохраняет все пары хэш-мультиотображения в файл снимка, из которого их быстро загружает
+// c_hash_multimap_load().
+// С текущей позиции файла записываются сигнатура и заголовок с количеством ключей, пар и слотов,
+// затем по одной записи на цепочку: хэш ключа, количество данных, ключ и все данные ключа.
+// Ключ и данные записывают функции _save_key и _save_data, получающие _context, в случае ошибки
+// они должны возвращать < 0. Ключи, хранящиеся внутри цепочек, записываются самим
+// хэш-мультиотображением (key_size байтов), поэтому в этом случае _save_key может быть NULL.
+// Записываются уже вычисленные хэши ключей, поэтому снимок можно загрузить только
+// в хэш-мультиотображение с той же функцией генерации хэша ключей.
+// Снимок переносим только между платформами с одинаковыми размером size_t и порядком байтов.
+// При одновременном доступе запись выполняется под блокировками всех полос на чтение.
+// В случае успеха возвращает > 0.
+// В случае ошибки записи (в том числе ошибки _save_key или _save_data) возвращает -4.
+// В случае иной ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_save(c_hash_multimap *const _hash_multimap,
+                               FILE *const _file,
+                               ptrdiff_t (*const _save_key)(const void *const _key,
+                                                            FILE *const _file,
+                                                            void *const _context),
+                               ptrdiff_t (*const _save_data)(const void *const _data,
+                                                             FILE *const _file,
+                                                             void *const _context),
+                               void *const _context)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_file == NULL)
+    {
+        return -2;
+    }
+    if ( (_save_data == NULL) ||
+         ( (_save_key == NULL) && (_hash_multimap->key_size == 0) ) )
+    {
+        return -3;
+    }
+
+    stripes_lock(_hash_multimap, 0);
+
+    size_t count = counter_load(_hash_multimap, &_hash_multimap->chains_count);
+
+    uint8_t signature[C_HASH_MULTIMAP_FILE_SIGNATURE];
+    file_signature(signature, "CHMM");
+    const size_t header[C_HASH_MULTIMAP_FILE_FIELDS] =
+    {
+        C_HASH_MULTIMAP_FILE_ORDER,
+        _hash_multimap->key_size,
+        _hash_multimap->key_string,
+        _hash_multimap->hash_finalizer,
+        count,
+        counter_load(_hash_multimap, &_hash_multimap->nodes_count),
+        _hash_multimap->slots_count
+    };
+
+    ptrdiff_t result = 1;
+    if ( (fwrite(signature, sizeof(signature), 1, _file) != 1) ||
+         (fwrite(header, sizeof(header), 1, _file) != 1) )
+    {
+        result = -4;
+        count = 0;
+    }
+
+    // Обходятся текущие слоты и старые слоты постепенного перестроения.
+    for (size_t t = 0; (t < 2)&&(count > 0); ++t)
+    {
+        c_hash_multimap_chain *const *const slots = (t == 0) ? _hash_multimap->slots :
+                                                               _hash_multimap->rehash_slots;
+        const size_t slots_count = (t == 0) ? _hash_multimap->slots_count :
+                                              _hash_multimap->rehash_slots_count;
+        const uint64_t *const occupied = slots_occupied(_hash_multimap, slots, slots_count);
+        for (size_t s = slot_next(occupied, 0, slots_count);
+             (s < slots_count)&&(count > 0);
+             s = slot_next(occupied, s + 1, slots_count))
+        {
+            const c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, slots, s);
+            while (select_chain != NULL)
+            {
+                const c_hash_multimap_values *const values = select_chain->values;
+                const size_t record[2] = {select_chain->k_hash, values->count};
+
+                ptrdiff_t r_code = (fwrite(record, sizeof(record), 1, _file) == 1) ? 1 : -1;
+                if (r_code >= 0)
+                {
+                    if (_hash_multimap->key_size != 0)
+                    {
+                        r_code = (fwrite(select_chain->key, _hash_multimap->key_size, 1, _file) == 1) ? 1 : -1;
+                    } else {
+                        r_code = _save_key(select_chain->key, _file, _context);
+                    }
+                }
+                for (size_t v = 0; (v < values->count)&&(r_code >= 0); ++v)
+                {
+                    r_code = _save_data(values->datas[v], _file, _context);
+                }
+
+                if (r_code < 0)
+                {
+                    result = -4;
+                    count = 0;
+                    break;
+                }
+
+                select_chain = select_chain->next_chain;
+                --count;
+            }
+        }
+    }
+
+    stripes_unlock(_hash_multimap);
+
+    return result;
+}
+
+// Загружает пары из файла снимка, начиная с текущей позиции файла.
+// Коды возврата совпадают с c_hash_multimap_load().
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+static ptrdiff_t pairs_load(c_hash_multimap *const _hash_multimap,
+                            FILE *const _file,
+                            void *(*const _load_key)(FILE *const _file,
+                                                     void *const _context),
+                            void *(*const _load_data)(FILE *const _file,
+                                                      void *const _context),
+                            void (*const _del_key)(void *const _key),
+                            void *const _context)
+{
+    if (_hash_multimap->chains_count != 0)
+    {
+        return -4;
+    }
+
+    // Проверяем сигнатуру и совместимость заголовка.
+    uint8_t signature[C_HASH_MULTIMAP_FILE_SIGNATURE],
+            expected[C_HASH_MULTIMAP_FILE_SIGNATURE];
+    file_signature(expected, "CHMM");
+    if ( (fread(signature, sizeof(signature), 1, _file) != 1) ||
+         (memcmp(signature, expected, 5) != 0) )
+    {
+        return -5;
+    }
+    if (memcmp(signature, expected, sizeof(signature)) != 0)
+    {
+        return -6;
+    }
+
+    size_t header[C_HASH_MULTIMAP_FILE_FIELDS];
+    if (fread(header, sizeof(header), 1, _file) != 1)
+    {
+        return -5;
+    }
+    if ( (header[0] != C_HASH_MULTIMAP_FILE_ORDER) ||
+         (header[1] != _hash_multimap->key_size) ||
+         (header[2] != _hash_multimap->key_string) ||
+         (header[3] != _hash_multimap->hash_finalizer) )
+    {
+        return -6;
+    }
+
+    const size_t chains_count = header[4];
+    size_t pairs_left = header[5];
+    if (pairs_left < chains_count)
+    {
+        return -5;
+    }
+    if (chains_count == 0)
+    {
+        return (pairs_left == 0) ? 0 : -5;
+    }
+
+    // Слоты сразу получают не меньше слотов сохраненного хэш-мультиотображения и достаточно слотов
+    // для всех ключей, поэтому во время загрузки перестроение не требуется.
+    // Память под все цепочки выделяется одним блоком.
+    if ( (header[6] > _hash_multimap->slots_count) &&
+         (slots_resize(_hash_multimap, header[6]) < 0) )
+    {
+        return -7;
+    }
+    if ( (slots_prepare(_hash_multimap, chains_count, 0) < 0) ||
+         (pool_reserve(_hash_multimap, &_hash_multimap->chains_pool, chains_count) < 0) )
+    {
+        return -7;
+    }
+
+    // Ключи снимка уникальны, поэтому цепочки встраиваются в слоты по сохраненным хэшам
+    // без поиска и сравнения ключей.
+    for (size_t c = 0; c < chains_count; ++c)
+    {
+        size_t record[2];
+        if (fread(record, sizeof(record), 1, _file) != 1)
+        {
+            return -8;
+        }
+        // У каждого из оставшихся ключей есть хотя бы одни данные.
+        const size_t count = record[1];
+        if ( (count == 0) || (count > pairs_left - (chains_count - 1 - c)) )
+        {
+            return -8;
+        }
+
+        const size_t values_capacity = pow2_round(count);
+        if (values_capacity == 0)
+        {
+            return -8;
+        }
+
+        heap_lock(_hash_multimap);
+        c_hash_multimap_chain *const new_chain = pool_alloc(_hash_multimap, &_hash_multimap->chains_pool);
+        heap_unlock(_hash_multimap);
+        if (new_chain == NULL)
+        {
+            return -7;
+        }
+        c_hash_multimap_values *const new_values = values_alloc(_hash_multimap, values_capacity);
+        if (new_values == NULL)
+        {
+            heap_lock(_hash_multimap);
+            pool_free(&_hash_multimap->chains_pool, new_chain);
+            heap_unlock(_hash_multimap);
+            return -7;
+        }
+        new_chain->k_hash = record[0];
+        new_chain->values = new_values;
+
+        // Ключ, хранящийся внутри цепочки, читается прямо в цепочку.
+        size_t key_loaded;
+        if (_hash_multimap->key_size != 0)
+        {
+            new_chain->key = new_chain + 1;
+            key_loaded = (fread(new_chain->key, _hash_multimap->key_size, 1, _file) == 1) &&
+                         ( (_hash_multimap->key_string == 0) ||
+                           (memchr(new_chain->key, 0, _hash_multimap->key_size) != NULL) );
+        } else {
+            new_chain->key = _load_key(_file, _context);
+            key_loaded = (new_chain->key != NULL);
+        }
+        if (key_loaded == 0)
+        {
+            chain_free(_hash_multimap, new_chain);
+            return -8;
+        }
+
+        size_t v = 0;
+        for ( ; v < count; ++v)
+        {
+            void *const data = _load_data(_file, _context);
+            if (data == NULL)
+            {
+                break;
+            }
+            values_set(_hash_multimap, new_values, v, data);
+        }
+        new_values->count = v;
+
+        // Ключ без данных в хэш-мультиотображение не попадает.
+        if (v == 0)
+        {
+            if ( (_del_key != NULL) && (_hash_multimap->key_size == 0) )
+            {
+                _del_key(new_chain->key);
+            }
+            chain_free(_hash_multimap, new_chain);
+            return -8;
+        }
+
+        values_index_build(_hash_multimap, new_values);
+        chain_attach(_hash_multimap, new_chain);
+
+        counter_add(_hash_multimap, &_hash_multimap->chains_count, 1);
+        counter_add(_hash_multimap, &_hash_multimap->nodes_count, v);
+
+        if (v < count)
+        {
+            return -8;
+        }
+        pairs_left -= count;
+    }
+
+    return (pairs_left == 0) ? 1 : -8;
+}
+
+// Загружает в пустое хэш-мультиотображение пары из файла снимка, записанного c_hash_multimap_save(),
+// начиная с текущей позиции файла.
+// Количество слотов заранее увеличивается под все ключи снимка, а цепочки встраиваются
+// по сохраненным хэшам, без вызова функции генерации хэша и сравнения ключей.
+// Хэш-мультиотображение должно быть создано с той же функцией генерации хэша ключей, что и
+// сохраненное, а также с теми же key_size, key_string и hash_finalizer.
+// Ключи и данные читают функции _load_key и _load_data, получающие _context, они возвращают
+// прочитанные ключ или данные, которые захватываются хэш-мультиотображением, а в случае
+// ошибки должны возвращать NULL. Ключи, хранящиеся внутри цепочек, читаются самим
+// хэш-мультиотображением, поэтому в этом случае _load_key может быть NULL.
+// Если для прочитанного ключа не удалось прочитать ни одних данных, ключ передается функции
+// удаления ключа _del_key (если она задана).
+// В случае успеха возвращает > 0.
+// Если в снимке нет пар, возвращает 0.
+// Если хэш-мультиотображение не пусто, возвращает -4.
+// Если файл не является снимком или поврежден до первой цепочки, возвращает -5.
+// Если снимок записан на другой платформе или с иными параметрами ключей, возвращает -6.
+// В случае нехватки памяти возвращает -7.
+// В случае ошибки чтения записей цепочек возвращает -8.
+// При ошибках -7 и -8 уже загруженные пары остаются в хэш-мультиотображении.
+// В случае иной ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_load(c_hash_multimap *const _hash_multimap,
+                               FILE *const _file,
+                               void *(*const _load_key)(FILE *const _file,
+                                                        void *const _context),
+                               void *(*const _load_data)(FILE *const _file,
+                                                         void *const _context),
+                               void (*const _del_key)(void *const _key),
+                               void *const _context)
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_file == NULL)
+    {
+        return -2;
+    }
+    if ( (_load_data == NULL) ||
+         ( (_load_key == NULL) && (_hash_multimap->key_size == 0) ) )
+    {
+        return -3;
+    }
+
+    stripes_lock(_hash_multimap, 1);
+    const ptrdiff_t r_code = pairs_load(_hash_multimap, _file, _load_key, _load_data, _del_key, _context);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Передает в файл накопленные в буфере байты.
+// В случае успеха возвращает > 0, в случае ошибки записи возвращает < 0.
+static ptrdiff_t writer_flush(c_hash_multimap_writer *const _writer)
+{
+    if ( (_writer->used > 0) && (fwrite(_writer->bytes, _writer->used, 1, _writer->file) != 1) )
+    {
+        return -1;
+    }
+    _writer->used = 0;
+    return 1;
+}
+
+// Добавляет в буфер заданные байты, при необходимости передавая буфер в файл.
+// Если _bytes == NULL, добавляется _size нулевых байтов (меньше C_HASH_MULTIMAP_FROZEN_ALIGN).
+// В случае успеха возвращает > 0, в случае ошибки записи возвращает < 0.
+static ptrdiff_t writer_put(c_hash_multimap_writer *const _writer,
+                            const void *const _bytes,
+                            const size_t _size)
+{
+    if (_size > C_HASH_MULTIMAP_WRITER_SIZE - _writer->used)
+    {
+        if (writer_flush(_writer) < 0)
+        {
+            return -1;
+        }
+        // Блок, не помещающийся в буфер, передается в файл напрямую.
+        if (_size > C_HASH_MULTIMAP_WRITER_SIZE)
+        {
+            return (fwrite(_bytes, _size, 1, _writer->file) == 1) ? 1 : -1;
+        }
+    }
+
+    if (_bytes != NULL)
+    {
+        memcpy(_writer->bytes + _writer->used, _bytes, _size);
+    } else {
+        memset(_writer->bytes + _writer->used, 0, _size);
+    }
+    _writer->used += _size;
+    return 1;
+}
+
+// Округляет размер ключа или данных образа вверх до кратного C_HASH_MULTIMAP_FROZEN_ALIGN.
+// В случае переполнения возвращает 0.
+static inline size_t frozen_align(const size_t _size)
+{
+    if (_size > SIZE_MAX - (C_HASH_MULTIMAP_FROZEN_ALIGN - 1))
+    {
+        return 0;
+    }
+    return (_size + C_HASH_MULTIMAP_FROZEN_ALIGN - 1) & ~(C_HASH_MULTIMAP_FROZEN_ALIGN - 1);
+}
+
+// Записывает в образ заданные байты, дополняя их нулями до выравнивания.
+// В случае успеха возвращает > 0, в случае ошибки записи возвращает < 0.
+static ptrdiff_t frozen_write(c_hash_multimap_writer *const _writer,
+                              const void *const _bytes,
+                              const size_t _size)
+{
+    if (writer_put(_writer, _bytes, _size) < 0)
+    {
+        return -1;
+    }
+    return writer_put(_writer, NULL, frozen_align(_size) - _size);
+}
+
+// Размер ключа цепочки в образе без выравнивания.
+static inline size_t frozen_key_size(const c_hash_multimap *const _hash_multimap,
+                                     const c_hash_multimap_chain *const _chain,
+                                     size_t (*const _key_size)(const void *const _key))
+{
+    if (_hash_multimap->key_size != 0)
+    {
+        return _hash_multimap->key_size;
+    }
+    return _key_size(_chain->key);
+}
+
+// Размер всех данных цепочки в образе с учетом выравнивания.
+// В случае переполнения возвращает SIZE_MAX.
+static size_t frozen_datas_size(const c_hash_multimap_chain *const _chain,
+                                size_t (*const _data_size)(const void *const _data))
+{
+    const c_hash_multimap_values *const values = _chain->values;
+    size_t size = 0;
+    for (size_t v = 0; v < values->count; ++v)
+    {
+        const size_t data_size = _data_size(values->datas[v]);
+        const size_t aligned_size = frozen_align(data_size);
+        if ( ( (aligned_size == 0) && (data_size != 0) ) ||
+             (aligned_size > SIZE_MAX - size) )
+        {
+            return SIZE_MAX;
+        }
+        size += aligned_size;
+    }
+    return size;
+}
+
+// Записывает образ, цепочки которого упорядочены по слотам образа.
+// _sizes - размеры цепочек в образе (ключ и все данные с учетом выравнивания),
+// _starts - индексы первых цепочек слотов (и количество цепочек в конце), _header - поля заголовка.
+// В случае успеха возвращает > 0, в случае ошибки записи возвращает < 0.
+static ptrdiff_t frozen_image_write(const c_hash_multimap *const _hash_multimap,
+                                    FILE *const _file,
+                                    size_t (*const _key_size)(const void *const _key),
+                                    size_t (*const _data_size)(const void *const _data),
+                                    const c_hash_multimap_chain *const *const _chains,
+                                    const size_t *const _sizes,
+                                    const size_t *const _starts,
+                                    const size_t *const _header,
+                                    const size_t _tables_size)
+{
+    const size_t slots_count = _header[4],
+                 chains_count = _header[5];
+    const size_t bytes_offset = frozen_align(_tables_size);
+
+    c_hash_multimap_writer writer;
+    writer.file = _file;
+    writer.used = 0;
+
+    uint8_t signature[C_HASH_MULTIMAP_FILE_SIGNATURE];
+    file_signature(signature, "CHMF");
+    if ( (writer_put(&writer, signature, sizeof(signature)) < 0) ||
+         (writer_put(&writer, _header, C_HASH_MULTIMAP_FROZEN_FIELDS * sizeof(size_t)) < 0) ||
+         (writer_put(&writer, _starts, (slots_count + 1) * sizeof(size_t)) < 0) )
+    {
+        return -1;
+    }
+
+    // Записи цепочек: ключ каждой цепочки лежит перед ее данными.
+    size_t offset = bytes_offset,
+           data_index = 0;
+    for (size_t c = 0; c < chains_count; ++c)
+    {
+        const c_hash_multimap_chain *const chain = _chains[c];
+        const size_t record[C_HASH_MULTIMAP_FROZEN_CHAIN] = {chain->k_hash, offset, data_index,
+                                                             chain->values->count};
+        if (writer_put(&writer, record, sizeof(record)) < 0)
+        {
+            return -1;
+        }
+        offset += _sizes[c];
+        data_index += chain->values->count;
+    }
+
+    // Массив смещений данных.
+    offset = bytes_offset;
+    for (size_t c = 0; c < chains_count; ++c)
+    {
+        const c_hash_multimap_chain *const chain = _chains[c];
+        const c_hash_multimap_values *const values = chain->values;
+        offset += frozen_align(frozen_key_size(_hash_multimap, chain, _key_size));
+        for (size_t v = 0; v < values->count; ++v)
+        {
+            if (writer_put(&writer, &offset, sizeof(size_t)) < 0)
+            {
+                return -1;
+            }
+            offset += frozen_align(_data_size(values->datas[v]));
+        }
+    }
+
+    // Ключи и данные.
+    if (writer_put(&writer, NULL, bytes_offset - _tables_size) < 0)
+    {
+        return -1;
+    }
+    for (size_t c = 0; c < chains_count; ++c)
+    {
+        const c_hash_multimap_chain *const chain = _chains[c];
+        const c_hash_multimap_values *const values = chain->values;
+        if (frozen_write(&writer, chain->key, frozen_key_size(_hash_multimap, chain, _key_size)) < 0)
+        {
+            return -1;
+        }
+        for (size_t v = 0; v < values->count; ++v)
+        {
+            if (frozen_write(&writer, values->datas[v], _data_size(values->datas[v])) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return writer_flush(&writer);
+}
+
+// Записывает образ замороженного хэш-мультиотображения, коды возврата совпадают
+// с c_hash_multimap_freeze().
+// При одновременном доступе вызывающий должен удерживать блокировки всех полос.
+static ptrdiff_t pairs_freeze(c_hash_multimap *const _hash_multimap,
+                              FILE *const _file,
+                              size_t (*const _key_size)(const void *const _key),
+                              size_t (*const _data_size)(const void *const _data))
+{
+    const size_t chains_count = counter_load(_hash_multimap, &_hash_multimap->chains_count),
+                 pairs_count = counter_load(_hash_multimap, &_hash_multimap->nodes_count);
+
+    // Загруженность слотов образа не превышает 1.
+    const size_t slots_count = pow2_round(chains_count);
+    if (slots_count == 0)
+    {
+        return -6;
+    }
+
+    // Размер заголовка, слотов, записей цепочек и массива смещений данных с контролем переполнения.
+    const size_t words_max = (SIZE_MAX - C_HASH_MULTIMAP_FILE_SIGNATURE - C_HASH_MULTIMAP_FROZEN_ALIGN) /
+                             sizeof(size_t);
+    size_t words = C_HASH_MULTIMAP_FROZEN_FIELDS + 1;
+    if (slots_count > words_max - words)
+    {
+        return -6;
+    }
+    words += slots_count;
+    if (chains_count > (words_max - words) / C_HASH_MULTIMAP_FROZEN_CHAIN)
+    {
+        return -6;
+    }
+    words += chains_count * C_HASH_MULTIMAP_FROZEN_CHAIN;
+    if (pairs_count > words_max - words)
+    {
+        return -6;
+    }
+    words += pairs_count;
+    const size_t tables_size = C_HASH_MULTIMAP_FILE_SIGNATURE + words * sizeof(size_t);
+
+    // Индексы первых цепочек слотов образа, а также цепочки, упорядоченные по слотам образа,
+    // вместе с их размерами в образе, чтобы не запрашивать размеры данных на каждом проходе.
+    const size_t starts_size = (slots_count + 1) * sizeof(size_t),
+                 chains_size = ( (chains_count > 0) ? chains_count : 1 ) *
+                               (sizeof(c_hash_multimap_chain*) + sizeof(size_t));
+    size_t *const starts = memory_alloc(_hash_multimap, starts_size);
+    const c_hash_multimap_chain **const chains = memory_alloc(_hash_multimap, chains_size);
+    if ( (starts == NULL) || (chains == NULL) )
+    {
+        if (starts != NULL)
+        {
+            memory_free(_hash_multimap, starts, starts_size);
+        }
+        if (chains != NULL)
+        {
+            memory_free(_hash_multimap, (void*)chains, chains_size);
+        }
+        return -5;
+    }
+    memset(starts, 0, starts_size);
+    size_t *const sizes = (size_t*)(chains + ( (chains_count > 0) ? chains_count : 1 ));
+
+    // Макросы дублирования обхода всех цепочек: текущих слотов и старых слотов постепенного перестроения.
+    #define C_HASH_MULTIMAP_FREEZE_BEGIN\
+    {\
+        size_t count = chains_count;\
+        for (size_t t = 0; (t < 2)&&(count > 0); ++t)\
+        {\
+            c_hash_multimap_chain *const *const table_slots = (t == 0) ? _hash_multimap->slots :\
+                                                                         _hash_multimap->rehash_slots;\
+            const size_t table_slots_count = (t == 0) ? _hash_multimap->slots_count :\
+                                                        _hash_multimap->rehash_slots_count;\
+            const uint64_t *const occupied = slots_occupied(_hash_multimap, table_slots, table_slots_count);\
+            for (size_t s = slot_next(occupied, 0, table_slots_count);\
+                 (s < table_slots_count)&&(count > 0);\
+                 s = slot_next(occupied, s + 1, table_slots_count))\
+            {\
+                const c_hash_multimap_chain *select_chain = *slot_list(_hash_multimap, table_slots, s);\
+                while (select_chain != NULL)\
+                {\
+                    const size_t slot = hash_finalize(select_chain->k_hash) & (slots_count - 1);
+
+    #define C_HASH_MULTIMAP_FREEZE_END\
+                    select_chain = select_chain->next_chain;\
+                    --count;\
+                }\
+            }\
+        }\
+    }
+
+    // Первый проход: количество цепочек в слотах образа.
+    C_HASH_MULTIMAP_FREEZE_BEGIN
+
+    ++starts[slot + 1];
+
+    C_HASH_MULTIMAP_FREEZE_END
+
+    for (size_t s = 0; s < slots_count; ++s)
+    {
+        starts[s + 1] += starts[s];
+    }
+
+    // Второй проход: цепочки упорядочиваются по слотам образа, вычисляются их размеры и размер образа.
+    size_t image_size = frozen_align(tables_size);
+    C_HASH_MULTIMAP_FREEZE_BEGIN
+
+    const size_t index = starts[slot]++;
+    chains[index] = select_chain;
+    const size_t key_size = frozen_key_size(_hash_multimap, select_chain, _key_size);
+    const size_t chain_size = frozen_align(key_size);
+    const size_t datas_size = frozen_datas_size(select_chain, _data_size);
+    if ( ( (chain_size == 0) && (key_size != 0) ) ||
+         (datas_size > SIZE_MAX - chain_size) ||
+         (chain_size + datas_size > SIZE_MAX - image_size) )
+    {
+        image_size = 0;
+    }
+    if (image_size != 0)
+    {
+        sizes[index] = chain_size + datas_size;
+        image_size += sizes[index];
+    }
+
+    C_HASH_MULTIMAP_FREEZE_END
+
+    // Каждый слот сместил свое начало к началу следующего, возвращаем начала на место.
+    memmove(starts + 1, starts, slots_count * sizeof(size_t));
+    starts[0] = 0;
+
+    ptrdiff_t result = (image_size == 0) ? -6 : 1;
+    if (result > 0)
+    {
+        const size_t header[C_HASH_MULTIMAP_FROZEN_FIELDS] =
+        {
+            C_HASH_MULTIMAP_FILE_ORDER,
+            _hash_multimap->key_size,
+            _hash_multimap->key_string,
+            _hash_multimap->hash_finalizer,
+            slots_count,
+            chains_count,
+            pairs_count,
+            image_size
+        };
+        if (frozen_image_write(_hash_multimap, _file, _key_size, _data_size, chains, sizes, starts,
+                               header, tables_size) < 0)
+        {
+            result = -4;
+        }
+    }
+
+    #undef C_HASH_MULTIMAP_FREEZE_BEGIN
+    #undef C_HASH_MULTIMAP_FREEZE_END
+
+    memory_free(_hash_multimap, starts, starts_size);
+    memory_free(_hash_multimap, (void*)chains, chains_size);
+
+    return result;
+}
+
+// Записывает с текущей позиции файла образ замороженного хэш-мультиотображения: плоскую структуру
+// без указателей, по которой c_hash_multimap_frozen_open() и c_hash_multimap_frozen_*() выполняют
+// поиск прямо в памяти, в которую образ загружен или отображен (например, mmap() в нескольких
+// процессах сразу), без копирования и без выделения памяти.
+// Образ состоит из сигнатуры и заголовка, таблицы слотов (индексы первых записей цепочек
+// каждого слота), непрерывного массива записей цепочек (хэш ключа, смещение ключа, индекс
+// и количество данных), массива смещений данных и, наконец, самих ключей и данных.
+// Байты ключа и данных копируются в образ: их количество возвращают функции _key_size
+// и _data_size, которые при каждом вызове должны возвращать для одних и тех же ключа и данных
+// одно и то же. Ключи, хранящиеся внутри цепочек, копируются целиком (key_size байтов), поэтому
+// в этом случае _key_size может быть NULL.
+// Ключи и данные выравниваются в образе на 8 байтов от начала образа.
+// Образ переносим только между платформами с одинаковыми размером size_t и порядком байтов.
+// При одновременном доступе запись выполняется под блокировками всех полос на чтение.
+// В случае успеха возвращает > 0.
+// В случае ошибки записи возвращает -4.
+// В случае нехватки памяти возвращает -5.
+// Если образ не помещается в адресное пространство, возвращает -6.
+// В случае иной ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_freeze(c_hash_multimap *const _hash_multimap,
+                                 FILE *const _file,
+                                 size_t (*const _key_size)(const void *const _key),
+                                 size_t (*const _data_size)(const void *const _data))
+{
+    if (_hash_multimap == NULL)
+    {
+        return -1;
+    }
+    if (_file == NULL)
+    {
+        return -2;
+    }
+    if ( (_data_size == NULL) ||
+         ( (_key_size == NULL) && (_hash_multimap->key_size == 0) ) )
+    {
+        return -3;
+    }
+
+    stripes_lock(_hash_multimap, 0);
+    const ptrdiff_t r_code = pairs_freeze(_hash_multimap, _file, _key_size, _data_size);
+    stripes_unlock(_hash_multimap);
+
+    return r_code;
+}
+
+// Готовит к поиску образ замороженного хэш-мультиотображения, записанный c_hash_multimap_freeze()
+// и размещенный в памяти по адресу _image, выровненному хотя бы на 8 байтов (например, началом
+// отображения файла). Образ не копируется и должен оставаться в памяти, пока им пользуются.
+// Функции генерации хэша и сравнения ключей должны совпадать с функциями замороженного
+// хэш-мультиотображения, для ключей, хранившихся внутри цепочек, они не нужны и могут быть NULL.
+// Сравнению передаются заданный ключ и ключ из образа.
+// Проверяются только заголовок и размеры таблиц, содержимое записей не проверяется, поэтому
+// образ должен быть получен из доверенного источника.
+// В случае успеха возвращает > 0.
+// Если образ не является образом замороженного хэш-мультиотображения или поврежден, возвращает -3.
+// Если образ записан на другой платформе, возвращает -4.
+// В случае иной ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_frozen_open(c_hash_multimap_frozen *const _frozen,
+                                      const void *const _image,
+                                      const size_t _size,
+                                      size_t (*const _hash_key)(const void *const _key),
+                                      size_t (*const _comp_key)(const void *const _key_a,
+                                                                const void *const _key_b))
+{
+    if (_frozen == NULL)
+    {
+        return -1;
+    }
+    if ( (_image == NULL) || ((uintptr_t)_image % C_HASH_MULTIMAP_FROZEN_ALIGN != 0) )
+    {
+        return -2;
+    }
+
+    uint8_t expected[C_HASH_MULTIMAP_FILE_SIGNATURE];
+    file_signature(expected, "CHMF");
+    if ( (_size < C_HASH_MULTIMAP_FILE_SIGNATURE + C_HASH_MULTIMAP_FROZEN_FIELDS * sizeof(size_t)) ||
+         (memcmp(_image, expected, 5) != 0) )
+    {
+        return -3;
+    }
+    if (memcmp(_image, expected, C_HASH_MULTIMAP_FILE_SIGNATURE) != 0)
+    {
+        return -4;
+    }
+
+    const size_t *const header = (const size_t*)((const uint8_t*)_image + C_HASH_MULTIMAP_FILE_SIGNATURE);
+    if (header[0] != C_HASH_MULTIMAP_FILE_ORDER)
+    {
+        return -4;
+    }
+    if ( (header[1] == 0) && ( (_hash_key == NULL) || (_comp_key == NULL) ) )
+    {
+        return -5;
+    }
+
+    // Таблицы должны помещаться в образ, а количество слотов - быть степенью двойки.
+    const size_t slots_count = header[4],
+                 chains_count = header[5],
+                 pairs_count = header[6];
+    const size_t words_max = (_size - C_HASH_MULTIMAP_FILE_SIGNATURE) / sizeof(size_t);
+    size_t words = C_HASH_MULTIMAP_FROZEN_FIELDS + 1;
+    if ( (header[7] > _size) ||
+         (slots_count == 0) || ( (slots_count & (slots_count - 1)) != 0 ) ||
+         (slots_count > words_max - words) ||
+         (chains_count > (words_max - words - slots_count) / C_HASH_MULTIMAP_FROZEN_CHAIN) )
+    {
+        return -3;
+    }
+    words += slots_count + chains_count * C_HASH_MULTIMAP_FROZEN_CHAIN;
+    if (pairs_count > words_max - words)
+    {
+        return -3;
+    }
+
+    const size_t *const slots = header + C_HASH_MULTIMAP_FROZEN_FIELDS;
+    if ( (slots[0] != 0) || (slots[slots_count] != chains_count) )
+    {
+        return -3;
+    }
+
+    _frozen->image = _image;
+    _frozen->hash_key = _hash_key;
+    _frozen->comp_key = _comp_key;
+    _frozen->key_size = header[1];
+    _frozen->key_string = header[2];
+    _frozen->hash_finalizer = header[3];
+    _frozen->slots_mask = slots_count - 1;
+    _frozen->slots = slots;
+    _frozen->chains = slots + slots_count + 1;
+    _frozen->datas = _frozen->chains + chains_count * C_HASH_MULTIMAP_FROZEN_CHAIN;
+    _frozen->chains_count = chains_count;
+    _frozen->pairs_count = pairs_count;
+
+    return 1;
+}
+
+// Ищет в образе запись цепочки, которая хранит заданный ключ.
+// Если цепочки нет, возвращает NULL.
+static const size_t *frozen_find(const c_hash_multimap_frozen *const _frozen,
+                                 const void *const _key)
+{
+    // Хэш вычисляется так же, как его вычислило замороженное хэш-мультиотображение.
+    size_t k_hash;
+    if (_frozen->key_size != 0)
+    {
+        k_hash = hash_bytes(_key, (_frozen->key_string != 0) ? strlen(_key) : _frozen->key_size);
+    } else {
+        k_hash = _frozen->hash_key(_key);
+        if (_frozen->hash_finalizer != 0)
+        {
+            k_hash = hash_finalize(k_hash);
+        }
+    }
+
+    const size_t slot = hash_finalize(k_hash) & _frozen->slots_mask;
+    const size_t *record = _frozen->chains + _frozen->slots[slot] * C_HASH_MULTIMAP_FROZEN_CHAIN;
+    const size_t *const end = _frozen->chains + _frozen->slots[slot + 1] * C_HASH_MULTIMAP_FROZEN_CHAIN;
+    for ( ; record < end; record += C_HASH_MULTIMAP_FROZEN_CHAIN)
+    {
+        if (record[0] == k_hash)
+        {
+            const void *const key = (const uint8_t*)_frozen->image + record[1];
+            size_t equal;
+            if (_frozen->key_size == 0)
+            {
+                equal = (_frozen->comp_key(_key, key) > 0);
+            } else if (_frozen->key_string != 0)
+            {
+                equal = (strcmp(key, _key) == 0);
+            } else {
+                equal = (memcmp(key, _key, _frozen->key_size) == 0);
+            }
+            if (equal != 0)
+            {
+                return record;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Проверяет наличие заданного ключа в замороженном хэш-мультиотображении.
+// Если ключ есть, возвращает > 0.
+// Если ключа нет, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_frozen_key_check(const c_hash_multimap_frozen *const _frozen,
+                                           const void *const _key)
+{
+    if (_frozen == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+
+    return (frozen_find(_frozen, _key) != NULL) ? 1 : 0;
+}
+
+// Возвращает количество данных, связанных с заданным ключом в замороженном хэш-мультиотображении.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_frozen_key_count(const c_hash_multimap_frozen *const _frozen,
+                                        const void *const _key,
+                                        size_t *const _error)
+{
+    if (_frozen == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+
+    const size_t *const record = frozen_find(_frozen, _key);
+    return (record != NULL) ? record[3] : 0;
+}
+
+// Копирует в заданный буфер указатели на данные (внутри образа), связанные с заданным ключом
+// в замороженном хэш-мультиотображении, но не более _capacity.
+// Возвращает количество скопированных указателей.
+// Если данных больше, чем помещается в буфер, узнать их полное количество можно
+// при помощи c_hash_multimap_frozen_key_count().
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_frozen_datas_fill(const c_hash_multimap_frozen *const _frozen,
+                                         const void *const _key,
+                                         const void **const _buffer,
+                                         const size_t _capacity,
+                                         size_t *const _error)
+{
+    if (_frozen == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+    if ( (_buffer == NULL) && (_capacity > 0) )
+    {
+        error_set(_error, 3);
+        return 0;
+    }
+
+    const size_t *const record = frozen_find(_frozen, _key);
+    if (record == NULL)
+    {
+        return 0;
+    }
+
+    const size_t count = (record[3] < _capacity) ? record[3] : _capacity;
+    const size_t *const offsets = _frozen->datas + record[2];
+    for (size_t v = 0; v < count; ++v)
+    {
+        _buffer[v] = (const uint8_t*)_frozen->image + offsets[v];
+    }
+
+    return count;
+}
+
+// Выбирает шард ключа по старшим битам перемешанного хэша и помещает в _k_hash неприведенный хэш
+// ключа, каким его вычислил бы сам шард. Функция генерации хэша вызывается один раз.
+static inline c_hash_multimap *shard_select(const c_hash_multimap_sharded *const _sharded,
+                                            const void *const _key,
+                                            size_t *const _k_hash)
+{
+    // Встроенная функция хэша ключей, хранящихся внутри цепочек, уже перемешивает все биты.
+    if (_sharded->shards[0]->key_size != 0)
+    {
+        *_k_hash = hash_inline(_sharded->shards[0], _key);
+        return (_sharded->shards_count == 1) ? _sharded->shards[0] :
+                                               _sharded->shards[*_k_hash >> _sharded->shard_shift];
+    }
+
+    const size_t hash = _sharded->hash_key(_key);
+    // Старшие биты перемешиваются всегда: у слабых функций хэша они часто нулевые.
+    const size_t mix_hash = hash_finalize(hash);
+
+    c_hash_multimap *const shard = (_sharded->shards_count == 1) ? _sharded->shards[0] :
+                                   _sharded->shards[mix_hash >> _sharded->shard_shift];
+
+    *_k_hash = (shard->hash_finalizer != 0) ? mix_hash : hash;
+
+    return shard;
+}
+
+// Создание хэш-мультиотображения с шардами: _shards_count независимых хэш-мультиотображений,
+// между которыми ключи распределяются по хэшу.
+// У каждого шарда свои слоты, пулы и блокировки, поэтому расширение и уменьшение слотов затрагивает
+// только данные одного шарда, а потоки, работающие с ключами разных шардов, не мешают друг другу.
+// _shards_count округляется вверх до степени двойки и должен быть не больше 1024.
+// _slots_count задает общее количество слотов, которое делится между шардами поровну.
+// Параметры _config применяются к каждому шарду. Если библиотека собрана с C_HASH_MULTIMAP_THREADS
+// и _config->lock_stripes == 0, каждый шард получает одну блокировку.
+// В случае ошибки возвращает NULL, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0): коды c_hash_multimap_create_ex() или 16, если количество шардов
+// недопустимо.
+c_hash_multimap_sharded *c_hash_multimap_sharded_create(size_t (*const _hash_key)(const void *const _key),
+                                                        size_t (*const _comp_key)(const void *const _key_a,
+                                                                                  const void *const _key_b),
+                                                        size_t (*const _comp_data)(const void *const _data_a,
+                                                                                   const void *const _data_b),
+                                                        const size_t _shards_count,
+                                                        const size_t _slots_count,
+                                                        const float _max_load_factor,
+                                                        const c_hash_multimap_config *const _config,
+                                                        size_t *const _error)
+{
+    if ( (_shards_count == 0) ||
+         (_shards_count > C_HASH_MULTIMAP_SHARDS_MAX) )
+    {
+        error_set(_error, 16);
+        return NULL;
+    }
+
+    c_hash_multimap_config config;
+    c_hash_multimap_config_init(&config);
+    if (_config != NULL)
+    {
+        config = *_config;
+    }
+#if defined(C_HASH_MULTIMAP_THREADS)
+    if (config.lock_stripes == 0)
+    {
+        config.lock_stripes = 1;
+    }
+#endif
+
+    const size_t shards_count = pow2_round(_shards_count);
+    const size_t slots_count = _slots_count / shards_count + (_slots_count % shards_count != 0);
+
+    // Ошибки параметров обнаружит создание первого шарда.
+    c_hash_multimap *const first_shard = c_hash_multimap_create_ex(_hash_key,
+                                                                   _comp_key,
+                                                                   _comp_data,
+                                                                   slots_count,
+                                                                   _max_load_factor,
+                                                                   &config,
+                                                                   _error);
+    if (first_shard == NULL)
+    {
+        return NULL;
+    }
+
+    const c_hash_multimap_allocator allocator = first_shard->allocator;
+    const size_t sharded_size = sizeof(c_hash_multimap_sharded) + shards_count * sizeof(c_hash_multimap*);
+    c_hash_multimap_sharded *const new_sharded = allocator.alloc(allocator.context, sharded_size);
+    if (new_sharded == NULL)
+    {
+        c_hash_multimap_delete(first_shard, NULL, NULL);
+        error_set(_error, 7);
+        return NULL;
+    }
+
+    new_sharded->hash_key = _hash_key;
+    new_sharded->shards_count = shards_count;
+    new_sharded->shard_shift = 0;
+    for (size_t s = shards_count; s > 1; s >>= 1)
+    {
+        ++new_sharded->shard_shift;
+    }
+    new_sharded->shard_shift = sizeof(size_t) * 8 - new_sharded->shard_shift;
+    new_sharded->allocator = allocator;
+
+    new_sharded->shards[0] = first_shard;
+    for (size_t s = 1; s < shards_count; ++s)
+    {
+        new_sharded->shards[s] = c_hash_multimap_create_ex(_hash_key,
+                                                           _comp_key,
+                                                           _comp_data,
+                                                           slots_count,
+                                                           _max_load_factor,
+                                                           &config,
+                                                           _error);
+        if (new_sharded->shards[s] == NULL)
+        {
+            for (size_t d = 0; d < s; ++d)
+            {
+                c_hash_multimap_delete(new_sharded->shards[d], NULL, NULL);
+            }
+            allocator.free(allocator.context, new_sharded, sharded_size);
+            return NULL;
+        }
+    }
+
+    return new_sharded;
+}
+
+// Удаляет хэш-мультиотображение с шардами.
+// В случае успеха возвращает > 0, иначе < 0.
+ptrdiff_t c_hash_multimap_sharded_delete(c_hash_multimap_sharded *const _sharded,
+                                         void (*const _del_key)(void *const _key),
+                                         void (*const _del_data)(void *const _data))
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+
+    for (size_t s = 0; s < _sharded->shards_count; ++s)
+    {
+        c_hash_multimap_delete(_sharded->shards[s], _del_key, _del_data);
+    }
+
+    const c_hash_multimap_allocator allocator = _sharded->allocator;
+    allocator.free(allocator.context, _sharded,
+                   sizeof(c_hash_multimap_sharded) + _sharded->shards_count * sizeof(c_hash_multimap*));
+
+    return 1;
+}
+
+// Очищает все шарды. Если min_load_factor равен 0, количество слотов шардов сохраняется,
+// иначе слоты каждого шарда освобождаются полностью (как при c_hash_multimap_clear()).
+// Шарды очищаются по очереди, поэтому при одновременном доступе очистка не является мгновенной:
+// пары, вставленные в уже очищенные шарды, сохраняются.
+// В случае успешного очищения возвращает > 0.
+// Если очищать не от чего, возвращает 0.
+// В случае ошибки возвращает < 0.
+ptrdiff_t c_hash_multimap_sharded_clear(c_hash_multimap_sharded *const _sharded,
+                                        void (*const _del_key)(void *const _key),
+                                        void (*const _del_data)(void *const _data))
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+
+    ptrdiff_t result = 0;
+    for (size_t s = 0; s < _sharded->shards_count; ++s)
+    {
+        if (c_hash_multimap_clear(_sharded->shards[s], _del_key, _del_data) > 0)
+        {
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+// Вставляет пару в шард ключа, коды возврата совпадают с c_hash_multimap_insert().
+ptrdiff_t c_hash_multimap_sharded_insert(c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         const void *const _data)
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    size_t k_hash;
+    c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return pair_add(shard, _key, k_hash, _data);
+}
+
+// Удаляет пару из шарда ключа, коды возврата совпадают с c_hash_multimap_erase().
+ptrdiff_t c_hash_multimap_sharded_erase(c_hash_multimap_sharded *const _sharded,
+                                        const void *const _key,
+                                        const void *const _data,
+                                        void (*const _del_key)(void *const _key),
+                                        void (*const _del_data)(void *const _data))
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    size_t k_hash;
+    c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return pair_erase(shard, _key, k_hash, _data, _del_key, _del_data);
+}
+
+// Удаляет из шарда ключа все пары с этим ключом, поведение совпадает с c_hash_multimap_erase_all().
+size_t c_hash_multimap_sharded_erase_all(c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         void (*const _del_key)(void *const _key),
+                                         void (*const _del_data)(void *const _data),
+                                         size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+
+    size_t k_hash;
+    c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return key_erase(shard, _key, k_hash, _del_key, _del_data);
+}
+
+// Обходит пары всех шардов, поведение совпадает с c_hash_multimap_for_each().
+// Шарды обходятся по очереди, каждый - под своими блокировками.
+ptrdiff_t c_hash_multimap_sharded_for_each(c_hash_multimap_sharded *const _sharded,
+                                           void (*const _action_key)(const void *const _key),
+                                           void (*const _action_data)(void *const _data))
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+
+    ptrdiff_t result = 0;
+    for (size_t s = 0; s < _sharded->shards_count; ++s)
+    {
+        const ptrdiff_t r_code = c_hash_multimap_for_each(_sharded->shards[s], _action_key, _action_data);
+        if (r_code < 0)
+        {
+            return r_code;
+        }
+        if (r_code > 0)
+        {
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+// Проверяет наличие ключа, коды возврата совпадают с c_hash_multimap_key_check().
+ptrdiff_t c_hash_multimap_sharded_key_check(const c_hash_multimap_sharded *const _sharded,
+                                            const void *const _key)
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+
+    size_t k_hash;
+    const c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return key_check(shard, _key, k_hash);
+}
+
+// Возвращает количество пар с заданным ключом, поведение совпадает с c_hash_multimap_key_count().
+size_t c_hash_multimap_sharded_key_count(const c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+
+    size_t k_hash;
+    const c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return key_count(shard, _key, k_hash);
+}
+
+// Проверяет наличие пары, коды возврата совпадают с c_hash_multimap_pair_check().
+ptrdiff_t c_hash_multimap_sharded_pair_check(const c_hash_multimap_sharded *const _sharded,
+                                             const void *const _key,
+                                             const void *const _data)
+{
+    if (_sharded == NULL)
+    {
+        return -1;
+    }
+    if (_key == NULL)
+    {
+        return -2;
+    }
+    if (_data == NULL)
+    {
+        return -3;
+    }
+
+    size_t k_hash;
+    const c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return pair_check(shard, _key, k_hash, _data);
+}
+
+// Возвращает количество пар с заданными ключом и данными, поведение совпадает
+// с c_hash_multimap_pair_count().
+size_t c_hash_multimap_sharded_pair_count(const c_hash_multimap_sharded *const _sharded,
+                                          const void *const _key,
+                                          const void *const _data,
+                                          size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+    if (_data == NULL)
+    {
+        error_set(_error, 3);
+        return 0;
+    }
+
+    size_t k_hash;
+    const c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return pair_count(shard, _key, k_hash, _data);
+}
+
+// Возвращает массив с указателями на все данные, связанные с заданным ключом, поведение совпадает
+// с c_hash_multimap_datas().
+// Возвращаемый массив необходимо удалять при помощи free().
+void** c_hash_multimap_sharded_datas(c_hash_multimap_sharded *const _sharded,
+                                     const void *const _key,
+                                     size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return NULL;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return NULL;
+    }
+
+    size_t k_hash;
+    c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return key_datas(shard, _key, k_hash, _error);
+}
+
+// Копирует в заданный буфер указатели на данные, связанные с заданным ключом, но не более _capacity,
+// поведение совпадает с c_hash_multimap_datas_fill().
+size_t c_hash_multimap_sharded_datas_fill(const c_hash_multimap_sharded *const _sharded,
+                                          const void *const _key,
+                                          void **const _buffer,
+                                          const size_t _capacity,
+                                          size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+    if (_key == NULL)
+    {
+        error_set(_error, 2);
+        return 0;
+    }
+    if ( (_buffer == NULL) && (_capacity > 0) )
+    {
+        error_set(_error, 3);
+        return 0;
+    }
+
+    size_t k_hash;
+    const c_hash_multimap *const shard = shard_select(_sharded, _key, &k_hash);
+
+    return key_fill(shard, _key, k_hash, _buffer, _capacity);
+}
+
+// Возвращает количество шардов.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+size_t c_hash_multimap_sharded_shards_count(const c_hash_multimap_sharded *const _sharded,
+                                            size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    return _sharded->shards_count;
+}
+
+// Возвращает количество уникальных ключей во всех шардах.
+// Счетчики шардов читаются без блокировок, поэтому при одновременных изменениях сумма
+// не является мгновенным снимком.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_sharded_unique_keys_count(const c_hash_multimap_sharded *const _sharded,
+                                                 size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t s = 0; s < _sharded->shards_count; ++s)
+    {
+        count += counter_load(_sharded->shards[s], &_sharded->shards[s]->chains_count);
+    }
+
+    return count;
+}
+
+// Возвращает количество пар во всех шардах.
+// Счетчики шардов читаются без блокировок, поэтому при одновременных изменениях сумма
+// не является мгновенным снимком.
+// В случае ошибки возвращает 0, и если _error != NULL, в заданное расположение помещается
+// код причины ошибки (> 0).
+// Так как функция может возвращать 0 и в случае успеха, и в случае ошибки, для детектирования ошибки
+// перед вызовом функции необходимо поместить 0 в заданное расположение ошибки.
+size_t c_hash_multimap_sharded_pairs_count(const c_hash_multimap_sharded *const _sharded,
+                                           size_t *const _error)
+{
+    if (_sharded == NULL)
+    {
+        error_set(_error, 1);
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t s = 0; s < _sharded->shards_count; ++s)
+    {
+        count += counter_load(_sharded->shards[s], &_sharded->shards[s]->nodes_count);
+    }
+
+    return count;
+}
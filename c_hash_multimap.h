@@ -1,90 +1,589 @@
-﻿/*
-    Файл реализации хэш-мультиотображения c_hash_multimap
-    Разработка, отладка и сборка производилась в:
-    ОС: Windows 10/x64
-    IDE: Code::Blocks 17.12
-    Компилятор: default Code::Blocks 17.12 MinGW
-    Разработчик: Глухманюк Максим
-    Эл. почта: mgneo@yandex.ru
-    Место: Российская Федерация, Самарская область, Сызрань
-    Дата: 11.04.2018
-    Лицензия: GPLv3
-*/
-
-#ifndef C_HASH_MULTIMAP_H
-#define C_HASH_MULTIMAP_H
-
-#include <stddef.h>
-
-typedef struct s_c_hash_multimap c_hash_multimap;
-
-c_hash_multimap *c_hash_multimap_create(size_t (*const _hash_key)(const void *const _key),
-                                        size_t (*const _comp_key)(const void *const _key_a,
-                                                                  const void *const _key_b),
-                                        size_t (*const _comp_data)(const void *const _data_a,
-                                                                   const void *const _data_b),
-                                        const size_t _slots_count,
-                                        const float _max_load_factor,
-                                        size_t *const _error);
-
-ptrdiff_t c_hash_multimap_delete(c_hash_multimap *const _hash_multimap,
-                                 void (*const _del_key)(void *const _key),
-                                 void (*const _del_data)(void *const _data));
-
-ptrdiff_t c_hash_multimap_clear(c_hash_multimap *const _hash_multimap,
-                                void (*const _del_key)(void *const _key),
-                                void (*const _del_data)(void *const _data));
-
-ptrdiff_t c_hash_multimap_resize(c_hash_multimap *const _hash_multimap,
-                                 const size_t _slots_count);
-
-ptrdiff_t c_hash_multimap_insert(c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 const void *const _data);
-
-ptrdiff_t c_hash_multimap_erase(c_hash_multimap *const _hash_multimap,
-                                const void *const _key,
-                                const void *const _data,
-                                void (*const _del_key)(void *const _key),
-                                void (*const _del_data)(void *const _data));
-
-size_t c_hash_multimap_erase_all(c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 void (*const _del_key)(void *const _key),
-                                 void (*const _del_data)(void *const _data),
-                                 size_t *const _error);
-
-ptrdiff_t c_hash_multimap_for_each(c_hash_multimap *const _hash_multimap,
-                                   void (*const _action_key)(const void *const _key),
-                                   void (*const _action_data)(void *const _data));
-
-ptrdiff_t c_hash_multimap_key_check(const c_hash_multimap *const _hash_multimap,
-                                    const void *const _key);
-
-size_t c_hash_multimap_key_count(const c_hash_multimap *const _hash_multimap,
-                                 const void *const _key,
-                                 size_t *const _error);
-
-ptrdiff_t c_hash_multimap_pair_check(const c_hash_multimap *const _hash_multimap,
-                                     const void *const _key,
-                                     const void *const _data);
-
-size_t c_hash_multimap_pair_count(const c_hash_multimap *const _hash_multimap,
-                                  const void *const _key,
-                                  const void *const _data,
-                                  size_t *const _error);
-
-void** c_hash_multimap_datas(c_hash_multimap *const _hash_multimap,
-                             const void *const _key,
-                             size_t *const _error);
-
-size_t c_hash_multimap_slots_count(const c_hash_multimap *const _hash_multimap,
-                                   size_t *const _error);
-
-size_t c_hash_multimap_unique_keys_count(const c_hash_multimap *const _hash_multimap,
-                                         size_t *const _error);
-
-size_t c_hash_multimap_pairs_count(const c_hash_multimap *const _hash_multimap,
-                                   size_t *const _error);
-
-#endif
+﻿/*
+    Файл реализации хэш-мультиотображения c_hash_multimap
+    Разработка, отладка и сборка производилась в:
+    ОС: Windows 10/x64
+    IDE: Code::Blocks 17.12
+    Компилятор: default Code::Blocks 17.12 MinGW
+    Разработчик: Глухманюк Максим
+    Эл. почта: mgneo@yandex.ru
+    Место: Российская Федерация, Самарская область, Сызрань
+    Дата: 11.04.2018
+    Лицензия: GPLv3
+*/
+
+#ifndef C_HASH_MULTIMAP_H
+#define C_HASH_MULTIMAP_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Механизмы хранения, задаваемые при создании хэш-мультиотображения.
+
+// Слоты хранят связные списки цепочек (механизм по умолчанию).
+#define C_HASH_MULTIMAP_ENGINE_CHAINED ( (size_t) 0 )
+
+// Открытая адресация: массив управляющих байтов с 7-битными метками хэшей, просматриваемый
+// группами (SSE2/AVX2, если доступны), и плоская таблица указателей на цепочки.
+// Количество слотов всегда является степенью двойки, а хэш ключа всегда перемешивается
+// финализатором (как при hash_finalizer != 0): иначе у слабых функций хэша одинаковыми оказались бы
+// и метки, и начала последовательностей проб.
+#define C_HASH_MULTIMAP_ENGINE_OPEN ( (size_t) 1 )
+
+// Корзины: каждый слот занимает строку кэша (64 байта) и хранит метки хэшей и указатели первых
+// цепочек своего списка, а также указатель на продолжение списка. Несовпадения при поиске
+// по большей части отсекаются по меткам в уже загруженной строке, без обращения к самим цепочкам.
+// Слот вмещает несколько цепочек, поэтому max_load_factor может достигать количества цепочек
+// в корзине (6 на 64-битных платформах, 11 на 32-битных).
+#define C_HASH_MULTIMAP_ENGINE_BUCKETS ( (size_t) 2 )
+
+// Максимальный размер ключа (в байтах), хранящегося внутри цепочки (c_hash_multimap_config::key_size).
+#define C_HASH_MULTIMAP_KEY_SIZE_MAX ( (size_t) 64 )
+
+// Количество столбцов гистограммы c_hash_multimap_statistics::chains_histogram.
+#define C_HASH_MULTIMAP_STATS_HISTOGRAM ( (size_t) 8 )
+
+typedef struct s_c_hash_multimap c_hash_multimap;
+
+typedef struct s_c_hash_multimap_allocator c_hash_multimap_allocator;
+
+typedef struct s_c_hash_multimap_config c_hash_multimap_config;
+
+typedef struct s_c_hash_multimap_view c_hash_multimap_view;
+
+typedef struct s_c_hash_multimap_iterator c_hash_multimap_iterator;
+
+typedef struct s_c_hash_multimap_executor c_hash_multimap_executor;
+
+// Хэш-мультиотображение, разделенное на независимые шарды (c_hash_multimap_sharded_*).
+typedef struct s_c_hash_multimap_sharded c_hash_multimap_sharded;
+
+typedef struct s_c_hash_multimap_frozen c_hash_multimap_frozen;
+
+typedef struct s_c_hash_multimap_statistics c_hash_multimap_statistics;
+
+// Исполнитель параллельных обходов (c_hash_multimap_for_each_parallel(), c_hash_multimap_clear_parallel(),
+// c_hash_multimap_delete_parallel()) и параллельного перестроения слотов.
+// Если исполнитель не задан (NULL) или run == NULL, используется встроенный пул: обход выполняют
+// вызывающий поток и до 63 создаваемых на время обхода потоков.
+// Без C_HASH_MULTIMAP_THREADS обход всегда выполняется вызывающим потоком.
+struct s_c_hash_multimap_executor
+{
+    // Пул потоков вызывающего: должен вызвать _task(_task_context, w) для каждого w от 0
+    // до _workers_count - 1 (одновременно, если потоков достаточно) и вернуться после завершения
+    // всех вызовов.
+    void (*run)(void *const _context,
+                void (*const _task)(void *const _task_context, const size_t _worker),
+                void *const _task_context,
+                const size_t _workers_count);
+    void *context;
+
+    // Количество исполнителей, 0 - по количеству процессоров.
+    size_t workers_count;
+};
+
+// Распределитель памяти, через который хэш-мультиотображение получает всю свою память.
+// Позволяет, например, обслуживать несколько хэш-мультиотображений одной арендой потока.
+struct s_c_hash_multimap_allocator
+{
+    // Выделяет блок памяти заданного размера.
+    // В случае ошибки должна возвращать NULL.
+    void *(*alloc)(void *const _context,
+                   const size_t _size);
+    // Освобождает блок памяти, ранее выделенный функцией alloc.
+    // Передается размер, который был запрошен при выделении блока.
+    void (*free)(void *const _context,
+                 void *const _memory,
+                 const size_t _size);
+    // Контекст, передаваемый в функции распределителя.
+    void *context;
+};
+
+// Дополнительные параметры создания хэш-мультиотображения.
+// Перед заполнением структуру необходимо инициализировать при помощи c_hash_multimap_config_init().
+struct s_c_hash_multimap_config
+{
+    // Распределитель памяти.
+    // Если alloc и free равны NULL, используются malloc() и free().
+    c_hash_multimap_allocator allocator;
+
+    // Размер страницы (в байтах), которыми пулы хэш-мультиотображения запрашивают память
+    // под цепочки и узлы.
+    // Если 0, используется размер по умолчанию.
+    size_t pool_page_size;
+
+    // Если не 0, количество слотов всегда округляется вверх до степени двойки, а слот
+    // выбирается маскированием хэша вместо деления с остатком.
+    size_t pow2_slots;
+
+    // Если не 0, хэш, возвращаемый функцией генерации хэша, дополнительно перемешивается
+    // финализатором (fmix из MurmurHash3).
+    // Позволяет равномерно распределять по слотам пары даже при слабой функции генерации хэша.
+    // Механизм открытой адресации и хэш-мультиотображение с полосами блокировок (lock_stripes != 0)
+    // перемешивают хэш всегда.
+    size_t hash_finalizer;
+
+    // Если не 0, ключи хранятся внутри цепочек: при создании цепочки key_size байт ключа копируются
+    // в нее, ключи сравниваются побайтно, а хэш вычисляется встроенной функцией, поэтому функции
+    // генерации хэша и сравнения ключей не вызываются и при создании могут быть равны NULL.
+    // Функции удаления ключей для скопированных ключей не вызываются: ключи, переданные вставке,
+    // по-прежнему принадлежат вызывающему, а функции обхода получают указатели на копии.
+    // Должен быть не больше C_HASH_MULTIMAP_KEY_SIZE_MAX.
+    size_t key_size;
+    // Если не 0 (вместе с key_size), ключи являются строками, завершенными нулем, длиной меньше key_size:
+    // хэшируется и сравнивается только строка до завершающего нуля.
+    // Вставка более длинной строки завершается ошибкой.
+    size_t key_string;
+
+    // Функция генерации хэша по данным, согласованная с функцией сравнения данных.
+    // Если задана, массив данных ключа, вместимость которого достигла data_index_capacity, получает
+    // хэш-индекс своих данных: удаление и поиск пары (c_hash_multimap_erase(),
+    // c_hash_multimap_pair_check(), c_hash_multimap_pair_count()) сравнивают заданные данные только
+    // с данными из цепочки индекса, а не перебирают все данные ключа.
+    // Массивы меньшей вместимости индекса не имеют.
+    // Кроме того, рядом с каждыми данными хранится их хэш (size_t на каждые данные), поэтому
+    // данные с другим хэшем отбрасываются сравнением чисел, без вызова функции сравнения данных.
+    size_t (*hash_data)(const void *const _data);
+    // Вместимость массива данных, с которой у него появляется индекс.
+    // Если меньше 64 (в том числе 0), используется 64.
+    size_t data_index_capacity;
+
+    // Механизм хранения (C_HASH_MULTIMAP_ENGINE_*).
+    size_t engine;
+
+    // Если не 0, расширение слотов при вставке выполняется постепенно: старые и новые слоты
+    // существуют одновременно, каждая изменяющая операция переносит в новые слоты цепочки
+    // не более чем rehash_step старых слотов, а поиск до окончания переноса просматривает обе таблицы.
+    // Если 0, все цепочки переносятся разом.
+    // Поддерживается только механизмом цепочек.
+    size_t rehash_step;
+
+    // Минимальная загруженность, при падении ниже которой удаление пар автоматически уменьшает
+    // количество слотов так, чтобы загруженность стала равна половине max_load_factor.
+    // Должна быть не больше четверти max_load_factor, чтобы расширение и уменьшение не чередовались.
+    // Автоматическое уменьшение не опускает количество слотов ниже начального количества
+    // для хэш-мультиотображения с нулем слотов, а очистка освобождает слоты полностью.
+    // Если 0, автоматическое уменьшение не выполняется.
+    float min_load_factor;
+
+    // Если не 0, хэш-мультиотображение допускает одновременный доступ из нескольких потоков.
+    // Слоты делятся на lock_stripes полос (значение округляется вверх до степени двойки, но должно быть
+    // не больше 1024), у каждой полосы своя блокировка чтения-записи: поиск блокирует полосу ключа
+    // на чтение, вставка и удаление - на запись, а операции над всей таблицей (изменение количества
+    // слотов, очистка, обход) блокируют все полосы.
+    // Поддерживается только механизмами цепочек и корзин без постепенного перестроения, количество слотов
+    // всегда является степенью двойки.
+    // Слот и полоса ключа определяются младшими битами хэша, поэтому хэш всегда перемешивается
+    // финализатором (как при hash_finalizer != 0), иначе ключи слабой функции хэша скапливались бы
+    // в немногих слотах одной полосы.
+    // Доступно, только если библиотека собрана с C_HASH_MULTIMAP_THREADS.
+    size_t lock_stripes;
+
+    // Если не 0, поиск по ключу (c_hash_multimap_key_check(), c_hash_multimap_key_count(),
+    // c_hash_multimap_pair_check(), c_hash_multimap_pair_count(), c_hash_multimap_datas(),
+    // c_hash_multimap_datas_view() и c_hash_multimap_datas_fill()) не блокирует полосы.
+    // Писатели по-прежнему блокируют полосы на запись, а удаленные цепочки, массивы данных и прежние
+    // слоты освобождаются с отсрочкой, когда их заведомо не просматривает ни один поток, поэтому
+    // функции удаления данных и ключей при удалении пар тоже вызываются с отсрочкой.
+    // Требует lock_stripes != 0.
+    size_t lock_free_reads;
+
+    // Если не 0, перестроение слотов механизма цепочек при изменении их количества выполняется
+    // параллельно на rebuild_executor, когда в хэш-мультиотображении не меньше rebuild_parallel
+    // уникальных ключей. Меньшие таблицы перестраиваются одним потоком: запуск исполнителей для них
+    // обходится дороже самого переноса (разумное значение - порядка 1 << 20).
+    // Исполнитель копируется при создании хэш-мультиотображения, его context должен оставаться
+    // действительным до удаления хэш-мультиотображения.
+    // Доступно, только если библиотека собрана с C_HASH_MULTIMAP_THREADS, иначе не учитывается.
+    size_t rebuild_parallel;
+    c_hash_multimap_executor rebuild_executor;
+};
+
+// Представление всех данных, связанных с одним ключом, без копирования.
+// Ссылается на внутреннюю память хэш-мультиотображения и действительно до первого его изменения.
+// При одновременном доступе представление не защищено блокировкой, поэтому изменения из других
+// потоков необходимо исключать самостоятельно или копировать данные c_hash_multimap_datas_fill().
+struct s_c_hash_multimap_view
+{
+    // Указатели на данные.
+    void *const *datas;
+    // Количество данных.
+    size_t count;
+};
+
+// Внешний итератор обхода пар: пары выдаются по слотам, в каждом слоте - по цепочкам,
+// в каждой цепочке - по данным.
+// Поля служебные, их заполняет c_hash_multimap_iterator_begin() и изменяет
+// c_hash_multimap_iterator_next().
+struct s_c_hash_multimap_iterator
+{
+    c_hash_multimap *hash_multimap;
+    // 0 - текущие слоты, 1 - старые слоты постепенного перестроения.
+    size_t table;
+    // Следующий просматриваемый слот.
+    size_t slot;
+    // Текущая цепочка и индекс ее следующих данных.
+    const void *chain;
+    size_t value;
+    // Количество цепочек, еще не пройденных до конца.
+    size_t count;
+};
+
+// Замороженное хэш-мультиотображение: образ, записанный c_hash_multimap_freeze(), по которому
+// поиск выполняется прямо в памяти образа (c_hash_multimap_frozen_*).
+// Поля служебные, их заполняет c_hash_multimap_frozen_open().
+struct s_c_hash_multimap_frozen
+{
+    const void *image;
+    size_t (*hash_key)(const void *const _key);
+    size_t (*comp_key)(const void *const _key_a,
+                       const void *const _key_b);
+    size_t key_size;
+    size_t key_string;
+    size_t hash_finalizer;
+    // Слоты (индексы первых записей цепочек), записи цепочек и смещения данных внутри образа.
+    size_t slots_mask;
+    const size_t *slots;
+    const size_t *chains;
+    const size_t *datas;
+    size_t chains_count;
+    size_t pairs_count;
+};
+
+// Статистика хэш-мультиотображения, заполняемая c_hash_multimap_stats().
+struct s_c_hash_multimap_statistics
+{
+    // Количество слотов (вместе со старыми слотами постепенного перестроения) и непустых слотов.
+    size_t slots_count,
+           occupied_slots;
+    size_t unique_keys_count,
+           pairs_count;
+    // chains_histogram[n] - количество слотов, хранящих n цепочек, последний столбец учитывает
+    // и слоты с большим количеством цепочек. Слот открытой адресации хранит не более одной цепочки.
+    size_t chains_histogram[C_HASH_MULTIMAP_STATS_HISTOGRAM];
+    // Наибольшее количество цепочек одного слота.
+    size_t max_chains;
+    // Наибольшее количество данных одного ключа и 99-й процентиль количества данных по ключам.
+    size_t max_values,
+           p99_values;
+    // Память (в байтах), занятая слотами, страницами пула цепочек (вместе с ключами, хранящимися
+    // внутри цепочек) и массивами данных, включая свободные объекты пулов.
+    size_t slots_bytes,
+           chains_bytes,
+           values_bytes;
+    // Количество перестроений слотов с момента создания.
+    size_t resizes_count;
+    // Счетчики с момента создания, которые ведутся, только если библиотека собрана
+    // с C_HASH_MULTIMAP_COUNTERS, иначе равны 0: количество поисков ключа, просмотренных ими цепочек
+    // и вызовов comp_key и comp_data.
+    // Отношение probes или key_comparisons к lookups, заметно превышающее 1, указывает на плохую
+    // функцию генерации хэша ключей.
+    size_t lookups,
+           probes,
+           key_comparisons,
+           data_comparisons;
+};
+
+void c_hash_multimap_config_init(c_hash_multimap_config *const _config);
+
+c_hash_multimap *c_hash_multimap_create(size_t (*const _hash_key)(const void *const _key),
+                                        size_t (*const _comp_key)(const void *const _key_a,
+                                                                  const void *const _key_b),
+                                        size_t (*const _comp_data)(const void *const _data_a,
+                                                                   const void *const _data_b),
+                                        const size_t _slots_count,
+                                        const float _max_load_factor,
+                                        size_t *const _error);
+
+c_hash_multimap *c_hash_multimap_create_ex(size_t (*const _hash_key)(const void *const _key),
+                                           size_t (*const _comp_key)(const void *const _key_a,
+                                                                     const void *const _key_b),
+                                           size_t (*const _comp_data)(const void *const _data_a,
+                                                                      const void *const _data_b),
+                                           const size_t _slots_count,
+                                           const float _max_load_factor,
+                                           const c_hash_multimap_config *const _config,
+                                           size_t *const _error);
+
+ptrdiff_t c_hash_multimap_delete(c_hash_multimap *const _hash_multimap,
+                                 void (*const _del_key)(void *const _key),
+                                 void (*const _del_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_clear(c_hash_multimap *const _hash_multimap,
+                                void (*const _del_key)(void *const _key),
+                                void (*const _del_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_delete_parallel(c_hash_multimap *const _hash_multimap,
+                                          void (*const _del_key)(void *const _key,
+                                                                 void *const _context,
+                                                                 const size_t _worker),
+                                          void (*const _del_data)(void *const _data,
+                                                                  void *const _context,
+                                                                  const size_t _worker),
+                                          void *const _context,
+                                          const c_hash_multimap_executor *const _executor);
+
+ptrdiff_t c_hash_multimap_clear_parallel(c_hash_multimap *const _hash_multimap,
+                                         void (*const _del_key)(void *const _key,
+                                                                void *const _context,
+                                                                const size_t _worker),
+                                         void (*const _del_data)(void *const _data,
+                                                                 void *const _context,
+                                                                 const size_t _worker),
+                                         void *const _context,
+                                         const c_hash_multimap_executor *const _executor);
+
+ptrdiff_t c_hash_multimap_resize(c_hash_multimap *const _hash_multimap,
+                                 const size_t _slots_count);
+
+ptrdiff_t c_hash_multimap_reserve(c_hash_multimap *const _hash_multimap,
+                                  const size_t _unique_keys_count,
+                                  const size_t _pairs_count);
+
+ptrdiff_t c_hash_multimap_shrink_to_fit(c_hash_multimap *const _hash_multimap);
+
+ptrdiff_t c_hash_multimap_rehash(c_hash_multimap *const _hash_multimap,
+                                 const size_t _steps);
+
+ptrdiff_t c_hash_multimap_insert(c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 const void *const _data);
+
+ptrdiff_t c_hash_multimap_insert_batch(c_hash_multimap *const _hash_multimap,
+                                       const void *const *const _keys,
+                                       const void *const *const _datas,
+                                       const size_t _count,
+                                       ptrdiff_t *const _results);
+
+ptrdiff_t c_hash_multimap_erase(c_hash_multimap *const _hash_multimap,
+                                const void *const _key,
+                                const void *const _data,
+                                void (*const _del_key)(void *const _key),
+                                void (*const _del_data)(void *const _data));
+
+size_t c_hash_multimap_erase_all(c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 void (*const _del_key)(void *const _key),
+                                 void (*const _del_data)(void *const _data),
+                                 size_t *const _error);
+
+ptrdiff_t c_hash_multimap_for_each(c_hash_multimap *const _hash_multimap,
+                                   void (*const _action_key)(const void *const _key),
+                                   void (*const _action_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_for_each_parallel(c_hash_multimap *const _hash_multimap,
+                                            void (*const _action_key)(const void *const _key,
+                                                                      void *const _context,
+                                                                      const size_t _worker),
+                                            void (*const _action_data)(void *const _data,
+                                                                       void *const _context,
+                                                                       const size_t _worker),
+                                            void *const _context,
+                                            const c_hash_multimap_executor *const _executor);
+
+ptrdiff_t c_hash_multimap_for_each_ex(c_hash_multimap *const _hash_multimap,
+                                      size_t (*const _action)(const void *const _key,
+                                                              void *const _data,
+                                                              void *const _context),
+                                      void *const _context);
+
+ptrdiff_t c_hash_multimap_iterator_begin(c_hash_multimap *const _hash_multimap,
+                                         c_hash_multimap_iterator *const _iterator);
+
+ptrdiff_t c_hash_multimap_iterator_next(c_hash_multimap_iterator *const _iterator,
+                                        const void **const _key,
+                                        void **const _data);
+
+ptrdiff_t c_hash_multimap_iterator_end(c_hash_multimap_iterator *const _iterator);
+
+ptrdiff_t c_hash_multimap_key_check(const c_hash_multimap *const _hash_multimap,
+                                    const void *const _key);
+
+size_t c_hash_multimap_key_count(const c_hash_multimap *const _hash_multimap,
+                                 const void *const _key,
+                                 size_t *const _error);
+
+ptrdiff_t c_hash_multimap_pair_check(const c_hash_multimap *const _hash_multimap,
+                                     const void *const _key,
+                                     const void *const _data);
+
+size_t c_hash_multimap_pair_count(const c_hash_multimap *const _hash_multimap,
+                                  const void *const _key,
+                                  const void *const _data,
+                                  size_t *const _error);
+
+void** c_hash_multimap_datas(c_hash_multimap *const _hash_multimap,
+                             const void *const _key,
+                             size_t *const _error);
+
+ptrdiff_t c_hash_multimap_datas_view(const c_hash_multimap *const _hash_multimap,
+                                     const void *const _key,
+                                     c_hash_multimap_view *const _view);
+
+size_t c_hash_multimap_datas_fill(const c_hash_multimap *const _hash_multimap,
+                                  const void *const _key,
+                                  void **const _buffer,
+                                  const size_t _capacity,
+                                  size_t *const _error);
+
+ptrdiff_t c_hash_multimap_find_batch(const c_hash_multimap *const _hash_multimap,
+                                     const void *const *const _keys,
+                                     const size_t _count,
+                                     c_hash_multimap_view *const _views);
+
+size_t c_hash_multimap_slots_count(const c_hash_multimap *const _hash_multimap,
+                                   size_t *const _error);
+
+size_t c_hash_multimap_unique_keys_count(const c_hash_multimap *const _hash_multimap,
+                                         size_t *const _error);
+
+size_t c_hash_multimap_pairs_count(const c_hash_multimap *const _hash_multimap,
+                                   size_t *const _error);
+
+ptrdiff_t c_hash_multimap_stats(c_hash_multimap *const _hash_multimap,
+                                c_hash_multimap_statistics *const _stats);
+
+ptrdiff_t c_hash_multimap_save(c_hash_multimap *const _hash_multimap,
+                               FILE *const _file,
+                               ptrdiff_t (*const _save_key)(const void *const _key,
+                                                            FILE *const _file,
+                                                            void *const _context),
+                               ptrdiff_t (*const _save_data)(const void *const _data,
+                                                             FILE *const _file,
+                                                             void *const _context),
+                               void *const _context);
+
+ptrdiff_t c_hash_multimap_load(c_hash_multimap *const _hash_multimap,
+                               FILE *const _file,
+                               void *(*const _load_key)(FILE *const _file,
+                                                        void *const _context),
+                               void *(*const _load_data)(FILE *const _file,
+                                                         void *const _context),
+                               void (*const _del_key)(void *const _key),
+                               void *const _context);
+
+ptrdiff_t c_hash_multimap_freeze(c_hash_multimap *const _hash_multimap,
+                                 FILE *const _file,
+                                 size_t (*const _key_size)(const void *const _key),
+                                 size_t (*const _data_size)(const void *const _data));
+
+ptrdiff_t c_hash_multimap_frozen_open(c_hash_multimap_frozen *const _frozen,
+                                      const void *const _image,
+                                      const size_t _size,
+                                      size_t (*const _hash_key)(const void *const _key),
+                                      size_t (*const _comp_key)(const void *const _key_a,
+                                                                const void *const _key_b));
+
+ptrdiff_t c_hash_multimap_frozen_key_check(const c_hash_multimap_frozen *const _frozen,
+                                           const void *const _key);
+
+size_t c_hash_multimap_frozen_key_count(const c_hash_multimap_frozen *const _frozen,
+                                        const void *const _key,
+                                        size_t *const _error);
+
+size_t c_hash_multimap_frozen_datas_fill(const c_hash_multimap_frozen *const _frozen,
+                                         const void *const _key,
+                                         const void **const _buffer,
+                                         const size_t _capacity,
+                                         size_t *const _error);
+
+c_hash_multimap_sharded *c_hash_multimap_sharded_create(size_t (*const _hash_key)(const void *const _key),
+                                                        size_t (*const _comp_key)(const void *const _key_a,
+                                                                                  const void *const _key_b),
+                                                        size_t (*const _comp_data)(const void *const _data_a,
+                                                                                   const void *const _data_b),
+                                                        const size_t _shards_count,
+                                                        const size_t _slots_count,
+                                                        const float _max_load_factor,
+                                                        const c_hash_multimap_config *const _config,
+                                                        size_t *const _error);
+
+ptrdiff_t c_hash_multimap_sharded_delete(c_hash_multimap_sharded *const _sharded,
+                                         void (*const _del_key)(void *const _key),
+                                         void (*const _del_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_sharded_clear(c_hash_multimap_sharded *const _sharded,
+                                        void (*const _del_key)(void *const _key),
+                                        void (*const _del_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_sharded_insert(c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         const void *const _data);
+
+ptrdiff_t c_hash_multimap_sharded_erase(c_hash_multimap_sharded *const _sharded,
+                                        const void *const _key,
+                                        const void *const _data,
+                                        void (*const _del_key)(void *const _key),
+                                        void (*const _del_data)(void *const _data));
+
+size_t c_hash_multimap_sharded_erase_all(c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         void (*const _del_key)(void *const _key),
+                                         void (*const _del_data)(void *const _data),
+                                         size_t *const _error);
+
+ptrdiff_t c_hash_multimap_sharded_for_each(c_hash_multimap_sharded *const _sharded,
+                                           void (*const _action_key)(const void *const _key),
+                                           void (*const _action_data)(void *const _data));
+
+ptrdiff_t c_hash_multimap_sharded_key_check(const c_hash_multimap_sharded *const _sharded,
+                                            const void *const _key);
+
+size_t c_hash_multimap_sharded_key_count(const c_hash_multimap_sharded *const _sharded,
+                                         const void *const _key,
+                                         size_t *const _error);
+
+ptrdiff_t c_hash_multimap_sharded_pair_check(const c_hash_multimap_sharded *const _sharded,
+                                             const void *const _key,
+                                             const void *const _data);
+
+size_t c_hash_multimap_sharded_pair_count(const c_hash_multimap_sharded *const _sharded,
+                                          const void *const _key,
+                                          const void *const _data,
+                                          size_t *const _error);
+
+void** c_hash_multimap_sharded_datas(c_hash_multimap_sharded *const _sharded,
+                                     const void *const _key,
+                                     size_t *const _error);
+
+size_t c_hash_multimap_sharded_datas_fill(const c_hash_multimap_sharded *const _sharded,
+                                          const void *const _key,
+                                          void **const _buffer,
+                                          const size_t _capacity,
+                                          size_t *const _error);
+
+size_t c_hash_multimap_sharded_shards_count(const c_hash_multimap_sharded *const _sharded,
+                                            size_t *const _error);
+
+size_t c_hash_multimap_sharded_unique_keys_count(const c_hash_multimap_sharded *const _sharded,
+                                                 size_t *const _error);
+
+size_t c_hash_multimap_sharded_pairs_count(const c_hash_multimap_sharded *const _sharded,
+                                           size_t *const _error);
+
+// Встроенные функции генерации хэша и сравнения ключей распространенных типов.
+// Хэши перемешивают все биты ключа, поэтому пригодны без hash_finalizer.
+
+size_t c_hash_multimap_hash_bytes(const void *const _bytes,
+                                  const size_t _size);
+
+size_t c_hash_multimap_hash_string(const void *const _key);
+
+size_t c_hash_multimap_hash_u32(const void *const _key);
+
+size_t c_hash_multimap_hash_u64(const void *const _key);
+
+size_t c_hash_multimap_hash_pointer(const void *const _key);
+
+size_t c_hash_multimap_comp_string(const void *const _key_a,
+                                   const void *const _key_b);
+
+size_t c_hash_multimap_comp_u32(const void *const _key_a,
+                                const void *const _key_b);
+
+size_t c_hash_multimap_comp_u64(const void *const _key_a,
+                                const void *const _key_b);
+
+size_t c_hash_multimap_comp_pointer(const void *const _key_a,
+                                    const void *const _key_b);
+
+#endif
@@ -1,178 +1,363 @@
-﻿#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "c_hash_multimap.h"
-
-// Функция генерации хэша по ключу-строке.
-size_t hash_key_s(const void *const _key)
-{
-    if (_key == NULL) return 0;
-
-    const char *c = (char*)_key;
-    size_t hash = 0;
-    while (*c != 0)
-    {
-        hash += *(c++);
-    }
-    return hash;
-}
-
-// Функция детального сравнения ключей-строк.
-size_t comp_key_s(const void *const _key_a,
-                  const void *const _key_b)
-{
-    if ( (_key_a == NULL) || (_key_b == NULL) ) return 0;
-
-    const char *const key_a = (char*)_key_a;
-    const char *const key_b = (char*)_key_b;
-
-    if (strcmp(key_a, key_b) == 0)
-    {
-        return 1;
-    }
-
-    return 0;
-}
-
-// Функция детального сравнения данных-float.
-size_t comp_data_f(const void *const _data_a,
-                   const void *const _data_b)
-{
-    if ( (_data_a == NULL) || (_data_b == NULL) ) return 0;
-
-    const float *const data_a = (float*)_data_a;
-    const float *const data_b = (float*)_data_b;
-
-    if (*data_a == *data_b)
-    {
-        return 1;
-    }
-
-    return 0;
-}
-
-// Функция печати ключа-строки.
-void print_key_s(const void *const _key)
-{
-    if (_key == NULL) return;
-    const char *const key = (char*)_key;
-    printf("[%s]: ", key);
-    return;
-}
-
-// Функция печати данных-float.
-void print_data_f(void *const _data)
-{
-    if (_data == NULL) return;
-    const float *const data = _data;
-    printf("%f \n", *data);
-    return;
-}
-
-int main(int argc, char **argv)
-{
-    size_t error;
-    c_hash_multimap *hash_multimap;
-
-    // Попытаемся создать хэш-мультиотображение.
-    hash_multimap = c_hash_multimap_create(hash_key_s,
-                                           comp_key_s,
-                                           comp_data_f,
-                                           10,
-                                           0.5f,
-                                           &error);
-    // Если произошла ошибка, покажем ее.
-    if (hash_multimap == NULL)
-    {
-        printf("create error: %Iu\n", error);
-        printf("Program end.\n");
-        getchar();
-        return -1;
-    }
-
-    // Добавим в хэш-мультиотображение пару.
-    const char *const key_1 = "One";
-    const float data_1 = 1.f;
-    {
-        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_1, &data_1);
-        // Покажем результат операции.
-        printf("insert[%s, %f]: %Id\n", key_1, data_1, r_code);
-    }
-
-    // Добавим в хэш-мультиотображение ту же пару.
-    {
-        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_1, &data_1);
-        // Покажем результат операции.
-        printf("insert[%s, %f]: %Id\n", key_1, data_1, r_code);
-    }
-
-    // Добавим в хэш-мультиотображение другую пару.
-    const char *const key_2 = "Two";
-    const float data_2 = 2.f;
-    {
-        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_2, &data_2);
-        // Покажем результат операции.
-        printf("insert[%s, %f]: %Id\n", key_2, data_2, r_code);
-    }
-
-    // Используя обход всех элементов, покажем содержимое каждого (каждой пары).
-    {
-        const ptrdiff_t r_code = c_hash_multimap_for_each(hash_multimap, print_key_s, print_data_f);
-        // Если возникла ошибка, покажем ее.
-        if (r_code < 0)
-        {
-            printf("for each error, r_code: %Id\n", r_code);
-            printf("Progran end.\n");
-            getchar();
-            return -2;
-        }
-    }
-
-    // Удалим все пары с ключом key_1.
-    {
-        error = 0;
-        const size_t d_count = c_hash_multimap_erase_all(hash_multimap, key_1, NULL, NULL, &error);
-        // Если возникла ошибка, покажем ее.
-        if ( (d_count == 0) && (error > 0) )
-        {
-            printf("erase all error: %Iu\n", error);
-            printf("Program end.\n");
-            getchar();
-            return -3;
-        }
-        // Покажем количество удаленных пар.
-        printf("erase all[%s]: %Iu\n", key_1, d_count);
-    }
-
-    // Используя обход всех элементов, покажем содержимое каждого (каждой пары).
-    {
-        const ptrdiff_t r_code = c_hash_multimap_for_each(hash_multimap, print_key_s, print_data_f);
-        // Если возникла ошибка, покажем ее.
-        if (r_code < 0)
-        {
-            printf("for each error, r_code: %Id\n", r_code);
-            printf("Progran end.\n");
-            getchar();
-            return -4;
-        }
-    }
-
-    // Удалим хэш-мультиотображение.
-    {
-        const ptrdiff_t r_code = c_hash_multimap_delete(hash_multimap, NULL, NULL);
-        // Если возникла ошибка, покажем ее.
-        if (r_code < 0)
-        {
-            printf("delete error, r_code: %Id\n", r_code);
-            printf("Program end.\n");
-            getchar();
-            return -5;
-        }
-    }
-
-    getchar();
-    return 0;
-}
-
-
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "c_hash_multimap.h"
+
+// Наивная функция генерации хэша по ключу-строке: сумма байтов.
+// Оставлена для сравнения со встроенными функциями: ключи из одинаковых букв (анаграммы) получают
+// одинаковый хэш, а хэши коротких строк занимают узкий диапазон.
+size_t hash_key_s(const void *const _key)
+{
+    if (_key == NULL) return 0;
+
+    const char *c = (char*)_key;
+    size_t hash = 0;
+    while (*c != 0)
+    {
+        hash += *(c++);
+    }
+    return hash;
+}
+
+// Наивная функция генерации хэша по ключу-числу: само число.
+// Числа с общим шагом, кратным степени двойки, при маскировании хэша попадают в малую часть слотов.
+size_t hash_key_u32(const void *const _key)
+{
+    if (_key == NULL) return 0;
+
+    return *(const uint32_t*)_key;
+}
+
+// Функция детального сравнения данных-float.
+size_t comp_data_f(const void *const _data_a,
+                   const void *const _data_b)
+{
+    if ( (_data_a == NULL) || (_data_b == NULL) ) return 0;
+
+    const float *const data_a = (float*)_data_a;
+    const float *const data_b = (float*)_data_b;
+
+    if (*data_a == *data_b)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+// Функция печати ключа-строки.
+void print_key_s(const void *const _key)
+{
+    if (_key == NULL) return;
+    const char *const key = (char*)_key;
+    printf("[%s]: ", key);
+    return;
+}
+
+// Функция печати данных-float.
+void print_data_f(void *const _data)
+{
+    if (_data == NULL) return;
+    const float *const data = _data;
+    printf("%f \n", *data);
+    return;
+}
+
+// Оценивает качество функции генерации хэша: распределяет _keys_count ключей по _slots_count слотам
+// (степень двойки, слот выбирается маскированием хэша, как при pow2_slots) и показывает количество
+// занятых слотов, длину самой длинной цепочки и среднее количество сравнений при успешном поиске.
+void hash_quality(const char *const _name,
+                  size_t (*const _hash_key)(const void *const _key),
+                  const void *const *const _keys,
+                  const size_t _keys_count,
+                  const size_t _slots_count)
+{
+    size_t *const chains = calloc(_slots_count, sizeof(size_t));
+    if (chains == NULL) return;
+
+    for (size_t k = 0; k < _keys_count; ++k)
+    {
+        ++chains[_hash_key(_keys[k]) & (_slots_count - 1)];
+    }
+
+    size_t occupied = 0,
+           longest = 0,
+           compares = 0;
+    for (size_t s = 0; s < _slots_count; ++s)
+    {
+        occupied += (chains[s] > 0);
+        if (chains[s] > longest)
+        {
+            longest = chains[s];
+        }
+        // Поиск i-го ключа цепочки выполняет i сравнений.
+        compares += chains[s] * (chains[s] + 1) / 2;
+    }
+    free(chains);
+
+    printf("%-24s occupied: %6lu/%lu, longest chain: %5lu, compares per hit: %.2f\n",
+           _name, (unsigned long)occupied, (unsigned long)_slots_count, (unsigned long)longest,
+           (double)compares / _keys_count);
+}
+
+// Сравнивает качество наивных и встроенных функций генерации хэша.
+void hash_quality_demo(void)
+{
+    const size_t keys_count = 5040,
+                 slots_count = 8192;
+    const void **const keys = malloc(keys_count * sizeof(void*));
+    char (*const strings)[8] = malloc(keys_count * sizeof(*strings));
+    uint32_t *const numbers = malloc(keys_count * sizeof(uint32_t));
+    if ( (keys == NULL) || (strings == NULL) || (numbers == NULL) )
+    {
+        free(keys);
+        free(strings);
+        free(numbers);
+        return;
+    }
+
+    // Все перестановки букв "abcdefg": 5040 анаграмм.
+    for (size_t k = 0; k < keys_count; ++k)
+    {
+        char letters[] = "abcdefg";
+        size_t rest = k;
+        for (size_t l = 0; l < 7; ++l)
+        {
+            // Выбираем букву по очередной цифре номера в факториальной системе счисления.
+            const size_t left = 7 - l;
+            const size_t pick = rest % left;
+            rest /= left;
+            strings[k][l] = letters[pick];
+            memmove(letters + pick, letters + pick + 1, left - pick);
+        }
+        strings[k][7] = 0;
+        keys[k] = strings[k];
+    }
+    hash_quality("anagrams, sum", hash_key_s, keys, keys_count, slots_count);
+    hash_quality("anagrams, built-in", c_hash_multimap_hash_string, keys, keys_count, slots_count);
+
+    // Числа с шагом 4096.
+    for (size_t k = 0; k < keys_count; ++k)
+    {
+        numbers[k] = (uint32_t)(k * 4096);
+        keys[k] = &numbers[k];
+    }
+    hash_quality("stride 4096, identity", hash_key_u32, keys, keys_count, slots_count);
+    hash_quality("stride 4096, built-in", c_hash_multimap_hash_u32, keys, keys_count, slots_count);
+
+    free(keys);
+    free(strings);
+    free(numbers);
+}
+
+// Наносекунды на операцию, прошедшие с момента _start.
+double benchmark_ns(const clock_t _start,
+                    const size_t _operations)
+{
+    return (double)(clock() - _start) * 1e9 / CLOCKS_PER_SEC / _operations;
+}
+
+// Замеряет механизмы хранения на _keys_count ключах size_t: вставку, успешный и неуспешный поиск
+// и удаление всех пар ключа (нс на операцию).
+// Хэш перемешивается финализатором, max_load_factor равен 0.75 (у корзин - 3), слоты механизма
+// цепочек являются степенью двойки.
+void engines_benchmark(const size_t _keys_count)
+{
+    static const char *const names[] = {"chained", "open", "buckets"};
+    static const size_t engines[] = {C_HASH_MULTIMAP_ENGINE_CHAINED,
+                                     C_HASH_MULTIMAP_ENGINE_OPEN,
+                                     C_HASH_MULTIMAP_ENGINE_BUCKETS};
+
+    // Первая половина массива - вставляемые ключи, вторая - отсутствующие.
+    uint64_t *const keys = malloc(2 * _keys_count * sizeof(uint64_t));
+    if (keys == NULL) return;
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    for (size_t k = 0; k < 2 * _keys_count; ++k)
+    {
+        // xorshift64: ключи без общего шага.
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        keys[k] = state;
+    }
+    static const float data = 1.f;
+
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); ++e)
+    {
+        c_hash_multimap_config config;
+        c_hash_multimap_config_init(&config);
+        config.engine = engines[e];
+        config.pow2_slots = 1;
+        config.hash_finalizer = 1;
+
+        size_t error = 0;
+        c_hash_multimap *const hash_multimap = c_hash_multimap_create_ex(c_hash_multimap_hash_u64,
+                                                                         c_hash_multimap_comp_u64,
+                                                                         c_hash_multimap_comp_pointer,
+                                                                         0,
+                                                                         (engines[e] == C_HASH_MULTIMAP_ENGINE_BUCKETS) ?
+                                                                         3.f : 0.75f,
+                                                                         &config,
+                                                                         &error);
+        if (hash_multimap == NULL)
+        {
+            printf("create error: %lu\n", (unsigned long)error);
+            continue;
+        }
+
+        clock_t start = clock();
+        for (size_t k = 0; k < _keys_count; ++k)
+        {
+            c_hash_multimap_insert(hash_multimap, &keys[k], &data);
+        }
+        const double insert_ns = benchmark_ns(start, _keys_count);
+
+        // Сумма не дает компилятору отбросить поиск.
+        size_t found = 0;
+        start = clock();
+        for (size_t k = 0; k < _keys_count; ++k)
+        {
+            found += c_hash_multimap_key_count(hash_multimap, &keys[k], NULL);
+        }
+        const double hit_ns = benchmark_ns(start, _keys_count);
+
+        start = clock();
+        for (size_t k = _keys_count; k < 2 * _keys_count; ++k)
+        {
+            found += (c_hash_multimap_key_check(hash_multimap, &keys[k]) > 0);
+        }
+        const double miss_ns = benchmark_ns(start, _keys_count);
+
+        start = clock();
+        for (size_t k = 0; k < _keys_count; ++k)
+        {
+            c_hash_multimap_erase_all(hash_multimap, &keys[k], NULL, NULL, NULL);
+        }
+        const double erase_ns = benchmark_ns(start, _keys_count);
+
+        printf("%8lu %-8s insert: %6.0f, hit: %6.0f, miss: %6.0f, erase_all: %6.0f (found: %lu)\n",
+               (unsigned long)_keys_count, names[e], insert_ns, hit_ns, miss_ns, erase_ns, (unsigned long)found);
+
+        c_hash_multimap_delete(hash_multimap, NULL, NULL);
+    }
+
+    free(keys);
+}
+
+int main(int argc, char **argv)
+{
+    size_t error;
+    c_hash_multimap *hash_multimap;
+
+    // Попытаемся создать хэш-мультиотображение.
+    hash_multimap = c_hash_multimap_create(c_hash_multimap_hash_string,
+                                           c_hash_multimap_comp_string,
+                                           comp_data_f,
+                                           10,
+                                           0.5f,
+                                           &error);
+    // Если произошла ошибка, покажем ее.
+    if (hash_multimap == NULL)
+    {
+        printf("create error: %Iu\n", error);
+        printf("Program end.\n");
+        getchar();
+        return -1;
+    }
+
+    // Добавим в хэш-мультиотображение пару.
+    const char *const key_1 = "One";
+    const float data_1 = 1.f;
+    {
+        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_1, &data_1);
+        // Покажем результат операции.
+        printf("insert[%s, %f]: %Id\n", key_1, data_1, r_code);
+    }
+
+    // Добавим в хэш-мультиотображение ту же пару.
+    {
+        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_1, &data_1);
+        // Покажем результат операции.
+        printf("insert[%s, %f]: %Id\n", key_1, data_1, r_code);
+    }
+
+    // Добавим в хэш-мультиотображение другую пару.
+    const char *const key_2 = "Two";
+    const float data_2 = 2.f;
+    {
+        const ptrdiff_t r_code = c_hash_multimap_insert(hash_multimap, key_2, &data_2);
+        // Покажем результат операции.
+        printf("insert[%s, %f]: %Id\n", key_2, data_2, r_code);
+    }
+
+    // Используя обход всех элементов, покажем содержимое каждого (каждой пары).
+    {
+        const ptrdiff_t r_code = c_hash_multimap_for_each(hash_multimap, print_key_s, print_data_f);
+        // Если возникла ошибка, покажем ее.
+        if (r_code < 0)
+        {
+            printf("for each error, r_code: %Id\n", r_code);
+            printf("Progran end.\n");
+            getchar();
+            return -2;
+        }
+    }
+
+    // Удалим все пары с ключом key_1.
+    {
+        error = 0;
+        const size_t d_count = c_hash_multimap_erase_all(hash_multimap, key_1, NULL, NULL, &error);
+        // Если возникла ошибка, покажем ее.
+        if ( (d_count == 0) && (error > 0) )
+        {
+            printf("erase all error: %Iu\n", error);
+            printf("Program end.\n");
+            getchar();
+            return -3;
+        }
+        // Покажем количество удаленных пар.
+        printf("erase all[%s]: %Iu\n", key_1, d_count);
+    }
+
+    // Используя обход всех элементов, покажем содержимое каждого (каждой пары).
+    {
+        const ptrdiff_t r_code = c_hash_multimap_for_each(hash_multimap, print_key_s, print_data_f);
+        // Если возникла ошибка, покажем ее.
+        if (r_code < 0)
+        {
+            printf("for each error, r_code: %Id\n", r_code);
+            printf("Progran end.\n");
+            getchar();
+            return -4;
+        }
+    }
+
+    // Удалим хэш-мультиотображение.
+    {
+        const ptrdiff_t r_code = c_hash_multimap_delete(hash_multimap, NULL, NULL);
+        // Если возникла ошибка, покажем ее.
+        if (r_code < 0)
+        {
+            printf("delete error, r_code: %Id\n", r_code);
+            printf("Program end.\n");
+            getchar();
+            return -5;
+        }
+    }
+
+    // Сравним качество функций генерации хэша.
+    hash_quality_demo();
+
+    // Сравним механизмы хранения.
+    engines_benchmark(10000);
+    engines_benchmark(200000);
+    engines_benchmark(2000000);
+
+    getchar();
+    return 0;
+}
+
+
@@ -0,0 +1,285 @@
+﻿// Нагрузочная проверка одновременного доступа: писатели (вставка, удаление, изменение количества слотов)
+// работают одновременно с читателями без блокировок (c_hash_multimap_key_count(),
+// c_hash_multimap_pair_check(), c_hash_multimap_datas_fill()), а в конце содержимое сверяется
+// с тем, что вставил каждый поток.
+// Сборка под ThreadSanitizer:
+// gcc -std=c99 -O1 -g -fsanitize=thread -DC_HASH_MULTIMAP_THREADS c_hash_multimap.c stress.c -lpthread
+
+// pthread_t в строгом режиме C99 объявляется, только если запрошен POSIX.1-2001.
+#if defined(C_HASH_MULTIMAP_THREADS) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "c_hash_multimap.h"
+
+#if defined(C_HASH_MULTIMAP_THREADS)
+
+#include <pthread.h>
+
+// Количество потоков, каждый из которых пишет только свои ключи, а читает и чужие.
+#define STRESS_THREADS ( (size_t) 4 )
+
+// Количество ключей каждого потока.
+#define STRESS_KEYS ( (size_t) 2000 )
+
+// Количество операций каждого потока.
+#define STRESS_OPERATIONS ( (size_t) 40000 )
+
+// Количество различных данных.
+#define STRESS_DATAS ( (size_t) 8 )
+
+// Ключи-строки всех потоков.
+static char stress_keys[STRESS_THREADS][STRESS_KEYS][16];
+
+// Данные: пары различаются адресами.
+static size_t stress_datas[STRESS_DATAS];
+
+// Состояние потока.
+typedef struct s_stress_worker
+{
+    c_hash_multimap *hash_multimap;
+    size_t index;
+
+    // Количество пар каждого ключа потока, известное только ему.
+    size_t counts[STRESS_KEYS];
+
+    // Количество несовпадений, обнаруженных потоком.
+    size_t failures;
+} stress_worker;
+
+// Генератор псевдослучайных чисел xorshift.
+static size_t stress_random(uint64_t *const _state)
+{
+    *_state ^= *_state << 13;
+    *_state ^= *_state >> 7;
+    *_state ^= *_state << 17;
+    return (size_t)(*_state >> 16);
+}
+
+// Проверяет, что указатель указывает на одни из данных.
+static int stress_data_valid(const void *const _data)
+{
+    return ( ((const size_t*)_data >= stress_datas) && ((const size_t*)_data < stress_datas + STRESS_DATAS) );
+}
+
+// Поток: изменяет свои ключи и читает свои и чужие.
+// Свои ключи изменяет только этот поток, поэтому количество их пар известно точно.
+static void *stress_work(void *const _worker)
+{
+    stress_worker *const worker = _worker;
+    c_hash_multimap *const hash_multimap = worker->hash_multimap;
+    uint64_t state = 0x9E3779B97F4A7C15u + worker->index;
+
+    for (size_t o = 0; o < STRESS_OPERATIONS; ++o)
+    {
+        const size_t k = stress_random(&state) % STRESS_KEYS;
+        const size_t operation = stress_random(&state) % 100;
+        const char *const key = stress_keys[worker->index][k];
+        const char *const other_key = stress_keys[(worker->index + 1) % STRESS_THREADS][k];
+        size_t *const data = &stress_datas[stress_random(&state) % STRESS_DATAS];
+
+        if (operation < 35)
+        {
+            if (c_hash_multimap_insert(hash_multimap, key, data) > 0)
+            {
+                ++worker->counts[k];
+            } else {
+                ++worker->failures;
+            }
+        } else if (operation < 45) {
+            const ptrdiff_t r_code = c_hash_multimap_erase(hash_multimap, key, data, NULL, NULL);
+            if (r_code > 0)
+            {
+                --worker->counts[k];
+            } else if (r_code < 0) {
+                ++worker->failures;
+            }
+        } else if (operation < 50) {
+            size_t error = 0;
+            const size_t erased = c_hash_multimap_erase_all(hash_multimap, key, NULL, NULL, &error);
+            if ( (error != 0) || (erased != worker->counts[k]) )
+            {
+                ++worker->failures;
+            }
+            worker->counts[k] = 0;
+        } else if (operation < 70) {
+            // Свой ключ: количество пар известно точно.
+            size_t error = 0;
+            if ( (c_hash_multimap_key_count(hash_multimap, key, &error) != worker->counts[k]) || (error != 0) )
+            {
+                ++worker->failures;
+            }
+            if (c_hash_multimap_pair_check(hash_multimap, key, data) < 0)
+            {
+                ++worker->failures;
+            }
+        } else if (operation < 95) {
+            // Чужой ключ изменяется одновременно, поэтому проверяются только сами данные.
+            void *buffer[4];
+            size_t error = 0;
+            const size_t filled = c_hash_multimap_datas_fill(hash_multimap, other_key, buffer, 4, &error);
+            if ( (error != 0) || (filled > 4) )
+            {
+                ++worker->failures;
+            }
+            for (size_t d = 0; (d < filled)&&(d < 4); ++d)
+            {
+                if (stress_data_valid(buffer[d]) == 0)
+                {
+                    ++worker->failures;
+                }
+            }
+            if (c_hash_multimap_pair_check(hash_multimap, other_key, data) < 0)
+            {
+                ++worker->failures;
+            }
+        } else if (worker->index == 0) {
+            // Изменение количества слотов переносит цепочки под ногами у читателей.
+            if (c_hash_multimap_resize(hash_multimap, 64 + stress_random(&state) % 20000) < 0)
+            {
+                ++worker->failures;
+            }
+        } else if (worker->index == 1) {
+            c_hash_multimap_shrink_to_fit(hash_multimap);
+        }
+    }
+
+    return NULL;
+}
+
+// Выполняет проверку с заданными параметрами.
+// Возвращает количество несовпадений.
+static size_t stress_run(const char *const _name,
+                         const c_hash_multimap_config *const _config,
+                         const float _max_load_factor)
+{
+    size_t error = 0;
+    c_hash_multimap *const hash_multimap = c_hash_multimap_create_ex(c_hash_multimap_hash_string,
+                                                                     c_hash_multimap_comp_string,
+                                                                     c_hash_multimap_comp_pointer,
+                                                                     0,
+                                                                     _max_load_factor,
+                                                                     _config,
+                                                                     &error);
+    if (hash_multimap == NULL)
+    {
+        printf("%-24s create error: %lu\n", _name, (unsigned long)error);
+        return 1;
+    }
+
+    stress_worker *const workers = calloc(STRESS_THREADS, sizeof(stress_worker));
+    pthread_t threads[STRESS_THREADS];
+    if (workers == NULL)
+    {
+        c_hash_multimap_delete(hash_multimap, NULL, NULL);
+        return 1;
+    }
+
+    size_t failures = 0;
+    size_t started = 0;
+    for (size_t t = 0; t < STRESS_THREADS; ++t)
+    {
+        workers[t].hash_multimap = hash_multimap;
+        workers[t].index = t;
+        if (pthread_create(&threads[t], NULL, stress_work, &workers[t]) != 0)
+        {
+            ++failures;
+            break;
+        }
+        ++started;
+    }
+    for (size_t t = 0; t < started; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    // Содержимое должно совпадать с тем, что вставил каждый поток.
+    size_t pairs_count = 0,
+           keys_count = 0;
+    for (size_t t = 0; t < started; ++t)
+    {
+        failures += workers[t].failures;
+        for (size_t k = 0; k < STRESS_KEYS; ++k)
+        {
+            pairs_count += workers[t].counts[k];
+            keys_count += (workers[t].counts[k] > 0);
+            if (c_hash_multimap_key_count(hash_multimap, stress_keys[t][k], NULL) != workers[t].counts[k])
+            {
+                ++failures;
+            }
+        }
+    }
+    if (c_hash_multimap_pairs_count(hash_multimap, NULL) != pairs_count)
+    {
+        ++failures;
+    }
+    if (c_hash_multimap_unique_keys_count(hash_multimap, NULL) != keys_count)
+    {
+        ++failures;
+    }
+
+    printf("%-24s keys: %6lu, pairs: %7lu, failures: %lu\n",
+           _name, (unsigned long)keys_count, (unsigned long)pairs_count, (unsigned long)failures);
+
+    free(workers);
+    c_hash_multimap_delete(hash_multimap, NULL, NULL);
+
+    return failures;
+}
+
+int main(void)
+{
+    for (size_t t = 0; t < STRESS_THREADS; ++t)
+    {
+        for (size_t k = 0; k < STRESS_KEYS; ++k)
+        {
+            sprintf(stress_keys[t][k], "t%luk%lu", (unsigned long)t, (unsigned long)k);
+        }
+    }
+
+    size_t failures = 0;
+
+    c_hash_multimap_config config;
+    c_hash_multimap_config_init(&config);
+    config.lock_stripes = 16;
+    config.lock_free_reads = 1;
+    failures += stress_run("chained, lock-free", &config, 0.75f);
+
+    config.min_load_factor = 0.1f;
+    config.rebuild_parallel = 1;
+    failures += stress_run("chained, auto shrink", &config, 0.75f);
+
+    c_hash_multimap_config_init(&config);
+    config.lock_stripes = 2;
+    config.lock_free_reads = 1;
+    config.engine = C_HASH_MULTIMAP_ENGINE_BUCKETS;
+    failures += stress_run("buckets, lock-free", &config, 3.f);
+
+    c_hash_multimap_config_init(&config);
+    config.lock_stripes = 16;
+    config.lock_free_reads = 1;
+    config.key_size = 16;
+    config.key_string = 1;
+    failures += stress_run("inline keys, lock-free", &config, 0.75f);
+
+    c_hash_multimap_config_init(&config);
+    config.lock_stripes = 4;
+    failures += stress_run("chained, stripe locks", &config, 0.75f);
+
+    return (failures == 0) ? 0 : 1;
+}
+
+#else
+
+int main(void)
+{
+    printf("stress: build with -DC_HASH_MULTIMAP_THREADS\n");
+    return 0;
+}
+
+#endif